@@ -6,6 +6,7 @@
 #include <CRSMatrix.h>
 #include <Matrix2D.h>
 #include <Vector.h>
+#include <perf_counters.h>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -29,6 +30,8 @@ void atmux(double *val, double *x, double *y, int *col_ind, int *row_ptr, int n)
 int main(int argc, char *argv[]) {
     double param_sparsity = 0.66;
     int param_iters = 10;
+    perf_region region;
+    perf_region_init(&region);
 
     if (argc != 2) {
         printf("Usage: %s <n>\n", argv[0]);
@@ -57,6 +60,7 @@ int main(int argc, char *argv[]) {
 
     // Calls the corresponding function to perform the computation
     printf("- Executing test...\n");
+    perf_region_begin(&region);
     double time_start = getClock();
     // ================================================
 
@@ -67,6 +71,7 @@ int main(int argc, char *argv[]) {
 
     // ================================================
     double time_finish = getClock();
+    perf_region_end(&region);
 
     // Prints execution report
     double checksum = Vector_checksum(out_vec);
@@ -75,6 +80,8 @@ int main(int argc, char *argv[]) {
     printf("sparsity= %g\n", param_sparsity);
     printf("chksum\t= %.0f\n", checksum);
     printf("iters\t= %i\n", param_iters);
+    perf_region_report(&region, 2.0 * CRSMatrix_getSize(in_sparseMat) * param_iters);
+    perf_region_free(&region);
 
     // Release allocated resources
     Matrix2D_delete(denseMat);
@@ -56,6 +56,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <perf_counters.h>
 
 #define VERBOSE 0
 #define BOOSTBLURFACTOR 90.0
@@ -98,6 +99,8 @@ int main(int argc, char *argv[])
 			        in the histogram of the magnitude of the
 			        gradient image that passes non-maximal
 			        suppression. */
+   perf_region region;
+   perf_region_init(&region);
 
    /****************************************************************************
    * Get the command line arguments.
@@ -147,6 +150,7 @@ int main(int argc, char *argv[])
       dirfilename = composedfname;
    }
 
+   perf_region_begin(&region);
    struct timespec start;
    clock_gettime(CLOCK_MONOTONIC, &start);
 
@@ -154,12 +158,16 @@ int main(int argc, char *argv[])
 
    struct timespec end;
    clock_gettime(CLOCK_MONOTONIC, &end);
+   perf_region_end(&region);
 
    double seconds;
    seconds = (end.tv_sec - start.tv_sec);
    seconds += (end.tv_nsec - start.tv_nsec) / 1000000000.0;
 
    printf("Total time: %.3f\n", seconds);
+   /* The stages mostly work on integers, so no flop count is reported */
+   perf_region_report(&region, 0.0);
+   perf_region_free(&region);
 
    /****************************************************************************
    * Write out the edge image to a file.
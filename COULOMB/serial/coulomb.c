@@ -6,6 +6,7 @@
 
 #include "Vector.h"
 #include "Matrix2D.h"
+#include <perf_counters.h>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -48,6 +49,8 @@ int main(int argc, char* argv[]) {
 	// Reads the test parameters from the command line
 	double arg_n = 0.0, arg_density = 0.1;
 	int param_iters = 1;
+	perf_region region;
+	perf_region_init(&region);
 	if(argc >= 2) sscanf(argv[1], "%lf", &arg_n);
 	if(argc >= 3) param_iters = atoi(argv[2]);
 	if(argc >= 4) sscanf(argv[3], "%lf", &arg_density);
@@ -79,6 +82,7 @@ int main(int argc, char* argv[]) {
 		
 	// Calls the function that performs the actual computation
 	printf("- Executing test...\n");
+	perf_region_begin(&region);
 	double time_start = getClock();
 	for(int iters = 0; iters < param_iters; iters++) {
 		coulomb(
@@ -88,6 +92,7 @@ int main(int argc, char* argv[]) {
 		);
 	}
 	double time_finish = getClock();
+	perf_region_end(&region);
 
 	// Prints an execution report
 	double checksum = Matrix2D_checksum(out_mat);
@@ -95,6 +100,9 @@ int main(int argc, char* argv[]) {
 	printf("size\t= %i\n", param_n);
 	printf("chksum\t= %.0f\n", checksum);
 	if(param_iters > 1) printf("iters\t= %i\n", param_iters);
+	// Each charge and point performs 16 operations, counting the square root as one
+	perf_region_report(&region, 16.0 * param_n * param_n * numCharges * param_iters);
+	perf_region_free(&region);
 
 	if(param_n < 9) { // Show example for small problems
 		printf("\n- Input vector b:\n");
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <omp.h>
+#include <perf_counters.h>
 //#include <mpi.h>
 
 extern void Step10_orig( int count1, float xxi, float yyi, float zzi, float fsrrmax2, float mp_rsm2, float *xx1, float *yy1, float *zz1, float *mass1, float *dxi, float *dyi, float *dzi );
@@ -56,6 +57,10 @@ int main( int argc, char *argv[] )
   unsigned long long tm1, tm2, tm3, tm4, total = 0;
   double t3, elapsed = 0.0, validation, final;
   double t1, t2;
+  double flops = 0.;
+  perf_region region;
+
+  perf_region_init( &region );
 
   //MPI_Init( &argc, &argv );
   //MPI_Comm_rank( MPI_COMM_WORLD, &rank );
@@ -123,6 +128,7 @@ int main( int argc, char *argv[] )
       for ( i = 0; i < NC; i++ ) M1[i] = 4;
       for ( i = 0; i < NC; i++ ) M2[i] = M1[i];
 
+      perf_region_begin( &region );
 #ifdef TIMEBASE
       tm1 = timebase();
 #else
@@ -143,6 +149,10 @@ int main( int argc, char *argv[] )
 #else
       t2 = mysecond();
 #endif
+      perf_region_end( &region );
+
+      /* Each interaction performs 28 operations, counting pow() as one */
+      flops = flops + 28. * count * n;
 
       validation = 0.;
       for ( i = 0; i < n; i++ )
@@ -178,6 +188,12 @@ int main( int argc, char *argv[] )
   }    
 #endif
   
+  if ( rank == 0 )
+  {
+      perf_region_report( &region, flops );
+  }
+  perf_region_free( &region );
+
   //MPI_Finalize();
 
   return 0;
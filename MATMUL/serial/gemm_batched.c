@@ -0,0 +1,199 @@
+#include <string.h>
+#include <cpu_features.h>
+#include <gemm_batched.h>
+#include <matrix.h>
+
+#define LANES GEMM_BATCH_LANES
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BATCH_X86 1
+#endif
+
+#ifdef _OPENMP
+#define PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define PRAGMA_SIMD
+#endif
+
+// Multiplies one interleaved group of matrices
+typedef void (*group_fn)(size_t m, size_t n, size_t p,
+                         const double *a, const double *b, double *c);
+
+// Kernel for any shape: the row of C being computed is accumulated in memory
+static void group_generic(size_t m, size_t n, size_t p,
+                          const double *restrict a, const double *restrict b, double *restrict c) {
+    for (size_t i = 0; i < m; i++) {
+        double *ci = &c[i * n * LANES];
+        memset(ci, 0, n * LANES * sizeof(double));
+        for (size_t k = 0; k < p; k++) {
+            const double *aik = &a[(i * p + k) * LANES];
+            const double *bk = &b[k * n * LANES];
+            for (size_t j = 0; j < n; j++) {
+                PRAGMA_SIMD
+                for (size_t l = 0; l < LANES; l++)
+                    ci[j * LANES + l] += aik[l] * bk[j * LANES + l];
+            }
+        }
+    }
+}
+
+// Kernel specialized at compile time for SIZE x SIZE matrices: all the loop
+// bounds are constants, so the compiler unrolls them and keeps the row of C
+// being computed in vector registers
+#define DEFINE_GROUP_KERNEL(SIZE, ISA, TARGET)                                        \
+    TARGET static void group_##SIZE##_##ISA(size_t m, size_t n, size_t p,             \
+                                            const double *restrict a,                 \
+                                            const double *restrict b,                 \
+                                            double *restrict c) {                     \
+        (void)m, (void)n, (void)p;                                                    \
+        for (int i = 0; i < SIZE; i++) {                                              \
+            double acc[SIZE][LANES] = {{0.0}};                                        \
+            for (int k = 0; k < SIZE; k++) {                                          \
+                const double *aik = &a[(i * SIZE + k) * LANES];                       \
+                const double *bk = &b[k * SIZE * LANES];                              \
+                for (int j = 0; j < SIZE; j++) {                                      \
+                    PRAGMA_SIMD                                                       \
+                    for (int l = 0; l < LANES; l++)                                   \
+                        acc[j][l] += aik[l] * bk[j * LANES + l];                      \
+                }                                                                     \
+            }                                                                         \
+            memcpy(&c[i * SIZE * LANES], acc, sizeof(acc));                           \
+        }                                                                             \
+    }
+
+#define DEFINE_GROUP_KERNELS(ISA, TARGET)  \
+    DEFINE_GROUP_KERNEL(4, ISA, TARGET)    \
+    DEFINE_GROUP_KERNEL(8, ISA, TARGET)    \
+    DEFINE_GROUP_KERNEL(16, ISA, TARGET)   \
+    DEFINE_GROUP_KERNEL(32, ISA, TARGET)
+
+DEFINE_GROUP_KERNELS(generic, )
+#ifdef BATCH_X86
+DEFINE_GROUP_KERNELS(avx2, TARGET_AVX2)
+DEFINE_GROUP_KERNELS(avx512, TARGET_AVX512)
+#endif
+
+#define GROUP_KERNEL_SET(ISA) {group_4_##ISA, group_8_##ISA, group_16_##ISA, group_32_##ISA}
+
+// Specialized kernels for each instruction set, from the most preferred one
+static const struct {
+    unsigned features;
+    group_fn kernels[4]; // Sizes 4, 8, 16 and 32
+} group_kernels[] = {
+#ifdef BATCH_X86
+    {CPU_FEATURE_AVX512F, GROUP_KERNEL_SET(avx512)},
+    {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, GROUP_KERNEL_SET(avx2)},
+#endif
+    {0, GROUP_KERNEL_SET(generic)},
+};
+
+static group_fn select_group_kernel(size_t m, size_t n, size_t p) {
+    int size_idx;
+    if (m != n || n != p)
+        return group_generic;
+    switch (m) {
+    case 4: size_idx = 0; break;
+    case 8: size_idx = 1; break;
+    case 16: size_idx = 2; break;
+    case 32: size_idx = 3; break;
+    default: return group_generic;
+    }
+
+    size_t isa = 0;
+    while (!cpu_supports(group_kernels[isa].features))
+        isa++;
+    return group_kernels[isa].kernels[size_idx];
+}
+
+size_t batch_interleaved_size(size_t rows, size_t cols, size_t count) {
+    return (count + LANES - 1) / LANES * LANES * rows * cols;
+}
+
+// Interleaves up to LANES matrices into one group, zero-padding the missing ones
+static void interleave_group(size_t size, size_t lanes, const double *src, size_t stride, double *dst) {
+    for (size_t e = 0; e < size; e++) {
+        for (size_t l = 0; l < lanes; l++)
+            dst[e * LANES + l] = src[l * stride + e];
+        for (size_t l = lanes; l < LANES; l++)
+            dst[e * LANES + l] = 0.0;
+    }
+}
+
+static void deinterleave_group(size_t size, size_t lanes, const double *src, double *dst, size_t stride) {
+    for (size_t e = 0; e < size; e++)
+        for (size_t l = 0; l < lanes; l++)
+            dst[l * stride + e] = src[e * LANES + l];
+}
+
+void batch_interleave(size_t rows, size_t cols, size_t count,
+                      const double *src, size_t stride, double *dst) {
+    const size_t size = rows * cols;
+    for (size_t g = 0; g * LANES < count; g++)
+        interleave_group(size, MIN(LANES, count - g * LANES), &src[g * LANES * stride], stride,
+                         &dst[g * LANES * size]);
+}
+
+void batch_deinterleave(size_t rows, size_t cols, size_t count,
+                        const double *src, double *dst, size_t stride) {
+    const size_t size = rows * cols;
+    for (size_t g = 0; g * LANES < count; g++)
+        deinterleave_group(size, MIN(LANES, count - g * LANES), &src[g * LANES * size],
+                           &dst[g * LANES * stride], stride);
+}
+
+void gemm_batched_interleaved(size_t m, size_t n, size_t p, size_t count,
+                              const double *A, const double *B, double *C) {
+    const group_fn kern = select_group_kernel(m, n, p);
+    const long groups = (long)((count + LANES - 1) / LANES);
+
+#pragma omp parallel for schedule(static)
+    for (long g = 0; g < groups; g++)
+        kern(m, n, p, &A[g * LANES * m * p], &B[g * LANES * p * n], &C[g * LANES * m * n]);
+}
+
+// Multiplies one matrix of the batch, used when no scratch memory is available
+static void gemm_single(size_t m, size_t n, size_t p, const double *A, const double *B, double *C) {
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (size_t k = 0; k < p; k++)
+                sum += A[i * p + k] * B[k * n + j];
+            C[i * n + j] = sum;
+        }
+    }
+}
+
+void gemm_batched(size_t m, size_t n, size_t p, size_t count,
+                  const double *A, size_t strideA,
+                  const double *B, size_t strideB,
+                  double *C, size_t strideC) {
+    const group_fn kern = select_group_kernel(m, n, p);
+    const long groups = (long)((count + LANES - 1) / LANES);
+
+#pragma omp parallel
+    {
+        // Each thread interleaves its groups in its own scratch buffers
+        double *a = (double *)new_buffer(m * p * LANES * sizeof(double));
+        double *b = (double *)new_buffer(p * n * LANES * sizeof(double));
+        double *c = (double *)new_buffer(m * n * LANES * sizeof(double));
+
+#pragma omp for schedule(static)
+        for (long g = 0; g < groups; g++) {
+            const size_t first = (size_t)g * LANES, lanes = MIN(LANES, count - first);
+            if (a && b && c) {
+                interleave_group(m * p, lanes, &A[first * strideA], strideA, a);
+                interleave_group(p * n, lanes, &B[first * strideB], strideB, b);
+                kern(m, n, p, a, b, c);
+                deinterleave_group(m * n, lanes, c, &C[first * strideC], strideC);
+            } else {
+                for (size_t l = first; l < first + lanes; l++)
+                    gemm_single(m, n, p, &A[l * strideA], &B[l * strideB], &C[l * strideC]);
+            }
+        }
+
+        delete_buffer(a);
+        delete_buffer(b);
+        delete_buffer(c);
+    }
+}
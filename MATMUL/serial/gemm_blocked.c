@@ -0,0 +1,110 @@
+#include <gemm.h>
+#include <matrix.h>
+
+/*   Blocking parameters (in doubles)
+
+     - A KC x NC panel of B stays in the L3 cache while it is being used.
+     - A MC x KC block of A stays in the L2 cache while it is being used.
+     - A KC x NR sliver of B stays in the L1 cache during the micro-kernel.
+     - A MR x NR tile of C is held in registers during the micro-kernel.
+*/
+#define BLK_NC 2048
+#define BLK_KC 256
+#define BLK_MC 128
+#define BLK_MR 4
+#define BLK_NR 8
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Computes a full MR x NR tile of C in registers; the tile is either
+// overwritten or accumulated depending on the value of accumulate
+static void micro_kernel(size_t kc, const double *restrict a, size_t lda,
+                         const double *restrict b, size_t ldb,
+                         double *restrict c, size_t ldc, int accumulate) {
+    double acc[BLK_MR][BLK_NR] = {{0.0}};
+
+    for (size_t k = 0; k < kc; k++) {
+        for (int i = 0; i < BLK_MR; i++) {
+            const double aik = a[i * lda + k];
+            for (int j = 0; j < BLK_NR; j++)
+                acc[i][j] += aik * b[k * ldb + j];
+        }
+    }
+
+    for (int i = 0; i < BLK_MR; i++) {
+        for (int j = 0; j < BLK_NR; j++) {
+            if (accumulate)
+                c[i * ldc + j] += acc[i][j];
+            else
+                c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+
+// Computes a partial mr x nr tile of C found at the edges of the matrix
+static void edge_kernel(size_t mr, size_t nr, size_t kc, const double *a, size_t lda,
+                        const double *b, size_t ldb, double *c, size_t ldc, int accumulate) {
+    double acc[BLK_MR][BLK_NR] = {{0.0}};
+
+    for (size_t k = 0; k < kc; k++) {
+        for (size_t i = 0; i < mr; i++) {
+            const double aik = a[i * lda + k];
+            for (size_t j = 0; j < nr; j++)
+                acc[i][j] += aik * b[k * ldb + j];
+        }
+    }
+
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) {
+            if (accumulate)
+                c[i * ldc + j] += acc[i][j];
+            else
+                c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+
+// C (m x n) = A (m x p) * B (p x n) over the linearized matrix data
+void gemm_blocked(size_t m, size_t n, size_t p,
+                  const double *A, size_t lda,
+                  const double *B, size_t ldb,
+                  double *C, size_t ldc) {
+    // Nothing to accumulate: the result is a zero matrix
+    if (p == 0) {
+        for (size_t i = 0; i < m; i++)
+            for (size_t j = 0; j < n; j++)
+                C[i * ldc + j] = 0;
+        return;
+    }
+
+    for (size_t jc = 0; jc < n; jc += BLK_NC) {
+        const size_t nc = MIN(BLK_NC, n - jc);
+        for (size_t pc = 0; pc < p; pc += BLK_KC) {
+            const size_t kc = MIN(BLK_KC, p - pc);
+            // The first panel initializes C, so no separate zeroing pass is needed
+            const int accumulate = pc > 0;
+            for (size_t ic = 0; ic < m; ic += BLK_MC) {
+                const size_t mc = MIN(BLK_MC, m - ic);
+                for (size_t jr = 0; jr < nc; jr += BLK_NR) {
+                    const size_t nr = MIN(BLK_NR, nc - jr);
+                    for (size_t ir = 0; ir < mc; ir += BLK_MR) {
+                        const size_t mr = MIN(BLK_MR, mc - ir);
+                        const double *a = &A[(ic + ir) * lda + pc];
+                        const double *b = &B[pc * ldb + jc + jr];
+                        double *c = &C[(ic + ir) * ldc + jc + jr];
+                        if (mr == BLK_MR && nr == BLK_NR)
+                            micro_kernel(kc, a, lda, b, ldb, c, ldc, accumulate);
+                        else
+                            edge_kernel(mr, nr, kc, a, lda, b, ldb, c, ldc, accumulate);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C (m x n) = A (m x p) * B (p x n)
+void matmul_blocked(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    gemm_blocked(m, n, p, A[0], matrix_ld(A, m, p), B[0], matrix_ld(B, p, n),
+                 C[0], matrix_ld(C, m, n));
+}
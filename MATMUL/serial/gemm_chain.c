@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <string.h>
+#include <gemm.h>
+#include <gemm_chain.h>
+#include <matrix.h>
+
+#define SPLIT(chain, i, j) ((chain)->split[(i) * (chain)->count + (j)])
+
+// Flops of multiplying A[i..s] (dims[i] x dims[s+1]) by A[s+1..j] (dims[s+1] x dims[j+1])
+static double product_flops(const size_t *dims, size_t i, size_t s, size_t j) {
+    return 2.0 * dims[i] * dims[s + 1] * dims[j + 1];
+}
+
+// Chooses the cheapest split of every sub-chain A[i..j] by increasing length;
+// cost is a count x count scratch table. Returns the flops of the whole chain
+static double plan(gemm_chain *chain, double *cost) {
+    const size_t count = chain->count;
+    for (size_t i = 0; i < count; i++)
+        cost[i * count + i] = 0.0;
+
+    for (size_t len = 2; len <= count; len++) {
+        for (size_t i = 0; i + len <= count; i++) {
+            const size_t j = i + len - 1;
+            for (size_t s = i; s < j; s++) {
+                const double flops = cost[i * count + s] + cost[(s + 1) * count + j] +
+                                     product_flops(chain->dims, i, s, j);
+                if (s == i || flops < cost[i * count + j]) {
+                    cost[i * count + j] = flops;
+                    SPLIT(chain, i, j) = s;
+                }
+            }
+        }
+    }
+    return cost[count - 1];
+}
+
+// Appends the products of A[i..j] to the steps in evaluation order (post-order)
+// and returns the operand holding its result; busy marks the buffers in use
+static gemm_chain_operand schedule(gemm_chain *chain, size_t i, size_t j,
+                                   int *busy, size_t *num_steps) {
+    if (i == j)
+        return (gemm_chain_operand){0, i};
+
+    const size_t s = SPLIT(chain, i, j);
+    const gemm_chain_operand left = schedule(chain, i, s, busy, num_steps);
+    const gemm_chain_operand right = schedule(chain, s + 1, j, busy, num_steps);
+
+    gemm_chain_step *step = &chain->steps[(*num_steps)++];
+    step->m = chain->dims[i];
+    step->n = chain->dims[j + 1];
+    step->p = chain->dims[s + 1];
+    step->left = left;
+    step->right = right;
+    step->out = 0;
+
+    // The result of the whole chain goes to C instead of the pool
+    const int last = i == 0 && j == chain->count - 1;
+    if (!last) {
+        // The output cannot alias the operands, which are released afterwards
+        while (busy[step->out])
+            step->out++;
+        busy[step->out] = 1;
+        if (step->out + 1 > chain->num_buffers)
+            chain->num_buffers = step->out + 1;
+        if (step->m * step->n > chain->buffer_size)
+            chain->buffer_size = step->m * step->n;
+    }
+    if (left.temp)
+        busy[left.index] = 0;
+    if (right.temp)
+        busy[right.index] = 0;
+    return (gemm_chain_operand){1, step->out};
+}
+
+gemm_chain *gemm_chain_new(size_t count, const size_t *dims) {
+    if (count < 1)
+        return NULL;
+    for (size_t i = 0; i <= count; i++)
+        if (dims[i] < 1)
+            return NULL;
+
+    gemm_chain *chain = (gemm_chain *)calloc(1, sizeof(gemm_chain));
+    if (!chain)
+        return NULL;
+    chain->count = count;
+    chain->dims = (size_t *)malloc((count + 1) * sizeof(size_t));
+    chain->split = (size_t *)calloc(count * count, sizeof(size_t));
+    chain->steps = (gemm_chain_step *)calloc(count, sizeof(gemm_chain_step));
+    chain->buffers = (double **)calloc(count, sizeof(double *));
+    double *cost = (double *)malloc(count * count * sizeof(double));
+    int *busy = (int *)calloc(count, sizeof(int));
+    if (!chain->dims || !chain->split || !chain->steps || !chain->buffers || !cost || !busy) {
+        free(cost);
+        free(busy);
+        gemm_chain_delete(chain);
+        return NULL;
+    }
+    memcpy(chain->dims, dims, (count + 1) * sizeof(size_t));
+
+    chain->flops = plan(chain, cost);
+    size_t num_steps = 0;
+    schedule(chain, 0, count - 1, busy, &num_steps);
+    free(cost);
+    free(busy);
+
+    // Every buffer can hold the largest intermediate, so that any of them can
+    // receive any product
+    for (size_t b = 0; b < chain->num_buffers; b++) {
+        chain->buffers[b] = (double *)new_buffer(chain->buffer_size * sizeof(double));
+        if (!chain->buffers[b]) {
+            gemm_chain_delete(chain);
+            return NULL;
+        }
+    }
+    return chain;
+}
+
+void gemm_chain_delete(gemm_chain *chain) {
+    if (!chain)
+        return;
+    if (chain->buffers)
+        for (size_t b = 0; b < chain->num_buffers; b++)
+            delete_buffer(chain->buffers[b]);
+    free(chain->buffers);
+    free(chain->steps);
+    free(chain->split);
+    free(chain->dims);
+    free(chain);
+}
+
+double gemm_chain_flops_left(size_t count, const size_t *dims) {
+    double flops = 0.0;
+    for (size_t s = 0; s + 1 < count; s++)
+        flops += product_flops(dims, 0, s, s + 1);
+    return flops;
+}
+
+// Appends the parenthesization of A[i..j] at *pos, keeping *left bytes free
+static void format_chain(const gemm_chain *chain, size_t i, size_t j, char **pos, size_t *left) {
+    int written;
+    if (i == j) {
+        written = snprintf(*pos, *left, "A%zu", i);
+    } else {
+        const size_t s = SPLIT(chain, i, j);
+        written = snprintf(*pos, *left, "(");
+        if (written < 0 || (size_t)written >= *left)
+            return;
+        *pos += written;
+        *left -= written;
+        format_chain(chain, i, s, pos, left);
+        written = snprintf(*pos, *left, " ");
+        if (written < 0 || (size_t)written >= *left)
+            return;
+        *pos += written;
+        *left -= written;
+        format_chain(chain, s + 1, j, pos, left);
+        written = snprintf(*pos, *left, ")");
+    }
+    if (written < 0 || (size_t)written >= *left)
+        return;
+    *pos += written;
+    *left -= written;
+}
+
+void gemm_chain_format(const gemm_chain *chain, char *str, size_t size) {
+    if (size < 1)
+        return;
+    str[0] = '\0';
+    format_chain(chain, 0, chain->count - 1, &str, &size);
+}
+
+// Data and leading dimension of an operand with the given columns
+static const double *operand_data(const gemm_chain *chain, double **const mats[],
+                                  gemm_chain_operand op, size_t cols, size_t *ld) {
+    if (op.temp) {
+        *ld = cols;
+        return chain->buffers[op.index];
+    }
+    *ld = matrix_ld(mats[op.index], chain->dims[op.index], cols);
+    return mats[op.index][0];
+}
+
+void gemm_chain_run(const gemm_chain *chain, double **const mats[], double **C) {
+    // A single matrix is copied
+    if (chain->count == 1) {
+        for (size_t i = 0; i < chain->dims[0]; i++)
+            memcpy(C[i], mats[0][i], chain->dims[1] * sizeof(double));
+        return;
+    }
+
+    for (size_t s = 0; s + 1 < chain->count; s++) {
+        const gemm_chain_step *step = &chain->steps[s];
+        size_t lda, ldb, ldc;
+        const double *A = operand_data(chain, mats, step->left, step->p, &lda);
+        const double *B = operand_data(chain, mats, step->right, step->n, &ldb);
+        double *out;
+        if (s + 2 == chain->count) {
+            out = C[0];
+            ldc = matrix_ld(C, step->m, step->n);
+        } else {
+            out = chain->buffers[step->out];
+            ldc = step->n;
+        }
+        gemm_packed(step->m, step->n, step->p, A, lda, B, ldb, 0.0, out, ldc);
+    }
+}
+
+int matmul_chain(size_t count, const size_t *dims, double **const mats[], double **C) {
+    gemm_chain *chain = gemm_chain_new(count, dims);
+    if (!chain)
+        return 0;
+    gemm_chain_run(chain, mats, C);
+    gemm_chain_delete(chain);
+    return 1;
+}
@@ -0,0 +1,95 @@
+#include <gemm.h>
+#include <gemm_complex.h>
+#include <matrix.h>
+
+// Smallest dimension for which GEMM_COMPLEX_AUTO selects 3M: below it, the
+// O(n^2) additions and temporaries cost more than the real product saved
+#define COMPLEX_3M_MIN 128
+
+complex_matrix complex_interleaved(double *data, size_t ld) {
+    complex_matrix mat = {data, data + 1, 2 * ld, 2};
+    return mat;
+}
+
+complex_matrix complex_planar(double *re, double *im, size_t ld) {
+    complex_matrix mat = {re, im, ld, 1};
+    return mat;
+}
+
+gemm_complex_algo gemm_complex_select(gemm_complex_algo algo, size_t m, size_t n, size_t p) {
+    if (algo != GEMM_COMPLEX_AUTO)
+        return algo;
+    return m >= COMPLEX_3M_MIN && n >= COMPLEX_3M_MIN && p >= COMPLEX_3M_MIN ? GEMM_COMPLEX_3M
+                                                                             : GEMM_COMPLEX_4M;
+}
+
+// Four real products accumulated directly into both parts of C, with no temporaries
+static void gemm_4m(size_t m, size_t n, size_t p, double alpha,
+                    complex_matrix A, complex_matrix B, double beta, complex_matrix C) {
+    gemm_strided(m, n, p, alpha, A.re, A.rs, A.cs, B.re, B.rs, B.cs, beta, C.re, C.rs, C.cs);
+    gemm_strided(m, n, p, -alpha, A.im, A.rs, A.cs, B.im, B.rs, B.cs, 1.0, C.re, C.rs, C.cs);
+    gemm_strided(m, n, p, alpha, A.re, A.rs, A.cs, B.im, B.rs, B.cs, beta, C.im, C.rs, C.cs);
+    gemm_strided(m, n, p, alpha, A.im, A.rs, A.cs, B.re, B.rs, B.cs, 1.0, C.im, C.rs, C.cs);
+}
+
+// Three real products; returns zero if the temporaries cannot be allocated
+static int gemm_3m(size_t m, size_t n, size_t p, double alpha,
+                   complex_matrix A, complex_matrix B, double beta, complex_matrix C) {
+    double *Sa = (double *)new_buffer(m * p * sizeof(double));
+    double *Sb = (double *)new_buffer(p * n * sizeof(double));
+    double *T = (double *)new_buffer(m * n * sizeof(double));
+    if (!Sa || !Sb || !T) {
+        delete_buffer(Sa);
+        delete_buffer(Sb);
+        delete_buffer(T);
+        return 0;
+    }
+
+    // Sa = Ar + Ai and Sb = Br + Bi
+    for (size_t i = 0; i < m; i++)
+        for (size_t k = 0; k < p; k++)
+            Sa[i * p + k] = A.re[i * A.rs + k * A.cs] + A.im[i * A.rs + k * A.cs];
+    for (size_t k = 0; k < p; k++)
+        for (size_t j = 0; j < n; j++)
+            Sb[k * n + j] = B.re[k * B.rs + j * B.cs] + B.im[k * B.rs + j * B.cs];
+
+    // Ci = alpha * T3 + beta * Ci
+    gemm_strided(m, n, p, alpha, Sa, p, 1, Sb, n, 1, beta, C.im, C.rs, C.cs);
+
+    // Cr = alpha * T1 + beta * Cr and Ci -= alpha * T1
+    gemm_strided(m, n, p, alpha, A.re, A.rs, A.cs, B.re, B.rs, B.cs, 0.0, T, n, 1);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            const double t = T[i * n + j];
+            double *cr = &C.re[i * C.rs + j * C.cs];
+            *cr = beta == 0.0 ? t : t + beta * *cr;
+            C.im[i * C.rs + j * C.cs] -= t;
+        }
+    }
+
+    // Cr -= alpha * T2 and Ci -= alpha * T2
+    gemm_strided(m, n, p, alpha, A.im, A.rs, A.cs, B.im, B.rs, B.cs, 0.0, T, n, 1);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            const double t = T[i * n + j];
+            C.re[i * C.rs + j * C.cs] -= t;
+            C.im[i * C.rs + j * C.cs] -= t;
+        }
+    }
+
+    delete_buffer(Sa);
+    delete_buffer(Sb);
+    delete_buffer(T);
+    return 1;
+}
+
+void gemm_complex(gemm_complex_algo algo, size_t m, size_t n, size_t p, double alpha,
+                  complex_matrix A, complex_matrix B, double beta, complex_matrix C) {
+    if (m == 0 || n == 0)
+        return;
+    // The 3M passes need a non-empty product
+    if (p > 0 && alpha != 0.0 && gemm_complex_select(algo, m, n, p) == GEMM_COMPLEX_3M &&
+        gemm_3m(m, n, p, alpha, A, B, beta, C))
+        return;
+    gemm_4m(m, n, p, alpha, A, B, beta, C);
+}
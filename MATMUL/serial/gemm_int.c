@@ -0,0 +1,450 @@
+#include <stdint.h>
+#include <string.h>
+#include <cpu_features.h>
+#include <gemm.h>
+#include <gemm_int.h>
+#include <matrix.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GEMM_INT_X86 1
+#include <immintrin.h>
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define ROUND_UP(x, m) (((x) + (m) - 1) / (m) * (m))
+
+#define INT8_LIMIT 127
+#define INT16_LIMIT 32767
+
+// Cache blocking shared by all the kernels (MC is a multiple of every mr, NC of
+// every nr, and KC is even)
+#define MC 96
+#define KC 512
+#define NC 4096
+
+// Largest micro-tile among all the available kernels
+#define INT_MAX_MR 8
+#define INT_MAX_NR 32
+
+/*   Integer micro-kernels compute a MR x NR tile of C from kp pairs of k
+     values, packed as pairs of int16 so that each 32-bit lane of a vector
+     holds the two values multiplied and added by vpmaddwd / vpdpwssd:
+
+       a = { A[0][0], A[0][1], A[1][0], A[1][1], ..., A[MR-1][0], A[MR-1][1],
+             A[0][2], A[0][3], ... }
+       b = { B[0][0], B[1][0], B[0][1], B[1][1], ..., B[0][NR-1], B[1][NR-1],
+             B[2][0], B[3][0], ... }
+
+     The int32 sums are converted to double and stored into C, or added to it
+     when accumulate is non-zero.
+*/
+typedef void (*int_ukernel_fn)(size_t kp, const int16_t *a, const int16_t *b,
+                               double *c, size_t ldc, int accumulate);
+
+// Portable kernel (4 x 8), relies on the compiler for vectorization
+static void int_kernel_generic(size_t kp, const int16_t *restrict a, const int16_t *restrict b,
+                               double *restrict c, size_t ldc, int accumulate) {
+    int32_t acc[4][8] = {{0}};
+
+    for (size_t q = 0; q < kp; q++) {
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 8; j++)
+                acc[i][j] += a[2 * i] * b[2 * j] + a[2 * i + 1] * b[2 * j + 1];
+        a += 8;
+        b += 16;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (accumulate)
+                c[i * ldc + j] += acc[i][j];
+            else
+                c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+
+#ifdef GEMM_INT_X86
+// Reads a pair of int16 as the 32-bit value to broadcast
+static inline int32_t load_pair(const int16_t *x) {
+    int32_t pair;
+    memcpy(&pair, x, sizeof(pair));
+    return pair;
+}
+
+// AVX2 kernel (6 x 16): 12 accumulators of 8 int32
+TARGET_AVX2 static inline void store_int_avx2(double *c, __m256i acc, int accumulate) {
+    __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(acc));
+    __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(acc, 1));
+    if (accumulate) {
+        lo = _mm256_add_pd(lo, _mm256_loadu_pd(c));
+        hi = _mm256_add_pd(hi, _mm256_loadu_pd(c + 4));
+    }
+    _mm256_storeu_pd(c, lo);
+    _mm256_storeu_pd(c + 4, hi);
+}
+
+#define INT_AVX2_ROW(r)                                                      \
+    do {                                                                     \
+        const __m256i ar = _mm256_set1_epi32(load_pair(a + 2 * r));          \
+        c##r##_0 = _mm256_add_epi32(c##r##_0, _mm256_madd_epi16(ar, b0));    \
+        c##r##_1 = _mm256_add_epi32(c##r##_1, _mm256_madd_epi16(ar, b1));    \
+    } while (0)
+
+#define INT_AVX2_STORE_ROW(r)                                  \
+    do {                                                       \
+        store_int_avx2(c + r * ldc, c##r##_0, accumulate);     \
+        store_int_avx2(c + r * ldc + 8, c##r##_1, accumulate); \
+    } while (0)
+
+TARGET_AVX2 static void int_kernel_avx2(size_t kp, const int16_t *restrict a, const int16_t *restrict b,
+                                        double *restrict c, size_t ldc, int accumulate) {
+    __m256i c0_0 = _mm256_setzero_si256(), c0_1 = _mm256_setzero_si256();
+    __m256i c1_0 = _mm256_setzero_si256(), c1_1 = _mm256_setzero_si256();
+    __m256i c2_0 = _mm256_setzero_si256(), c2_1 = _mm256_setzero_si256();
+    __m256i c3_0 = _mm256_setzero_si256(), c3_1 = _mm256_setzero_si256();
+    __m256i c4_0 = _mm256_setzero_si256(), c4_1 = _mm256_setzero_si256();
+    __m256i c5_0 = _mm256_setzero_si256(), c5_1 = _mm256_setzero_si256();
+
+    for (size_t q = 0; q < kp; q++) {
+        const __m256i b0 = _mm256_load_si256((const __m256i *)b);
+        const __m256i b1 = _mm256_load_si256((const __m256i *)(b + 16));
+        INT_AVX2_ROW(0);
+        INT_AVX2_ROW(1);
+        INT_AVX2_ROW(2);
+        INT_AVX2_ROW(3);
+        INT_AVX2_ROW(4);
+        INT_AVX2_ROW(5);
+        a += 12;
+        b += 32;
+    }
+
+    INT_AVX2_STORE_ROW(0);
+    INT_AVX2_STORE_ROW(1);
+    INT_AVX2_STORE_ROW(2);
+    INT_AVX2_STORE_ROW(3);
+    INT_AVX2_STORE_ROW(4);
+    INT_AVX2_STORE_ROW(5);
+}
+
+// AVX-512 VNNI kernel (8 x 32): 16 accumulators of 16 int32
+TARGET_AVX512VNNI static inline void store_int_avx512(double *c, __m512i acc, int accumulate) {
+    __m512d lo = _mm512_cvtepi32_pd(_mm512_castsi512_si256(acc));
+    __m512d hi = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(acc, 1));
+    if (accumulate) {
+        lo = _mm512_add_pd(lo, _mm512_loadu_pd(c));
+        hi = _mm512_add_pd(hi, _mm512_loadu_pd(c + 8));
+    }
+    _mm512_storeu_pd(c, lo);
+    _mm512_storeu_pd(c + 8, hi);
+}
+
+#define INT_AVX512_ROW(r)                                             \
+    do {                                                              \
+        const __m512i ar = _mm512_set1_epi32(load_pair(a + 2 * r));   \
+        c##r##_0 = _mm512_dpwssd_epi32(c##r##_0, ar, b0);             \
+        c##r##_1 = _mm512_dpwssd_epi32(c##r##_1, ar, b1);             \
+    } while (0)
+
+#define INT_AVX512_STORE_ROW(r)                                   \
+    do {                                                          \
+        store_int_avx512(c + r * ldc, c##r##_0, accumulate);      \
+        store_int_avx512(c + r * ldc + 16, c##r##_1, accumulate); \
+    } while (0)
+
+TARGET_AVX512VNNI static void int_kernel_avx512vnni(size_t kp, const int16_t *restrict a,
+                                                    const int16_t *restrict b,
+                                                    double *restrict c, size_t ldc, int accumulate) {
+    __m512i c0_0 = _mm512_setzero_si512(), c0_1 = _mm512_setzero_si512();
+    __m512i c1_0 = _mm512_setzero_si512(), c1_1 = _mm512_setzero_si512();
+    __m512i c2_0 = _mm512_setzero_si512(), c2_1 = _mm512_setzero_si512();
+    __m512i c3_0 = _mm512_setzero_si512(), c3_1 = _mm512_setzero_si512();
+    __m512i c4_0 = _mm512_setzero_si512(), c4_1 = _mm512_setzero_si512();
+    __m512i c5_0 = _mm512_setzero_si512(), c5_1 = _mm512_setzero_si512();
+    __m512i c6_0 = _mm512_setzero_si512(), c6_1 = _mm512_setzero_si512();
+    __m512i c7_0 = _mm512_setzero_si512(), c7_1 = _mm512_setzero_si512();
+
+    for (size_t q = 0; q < kp; q++) {
+        const __m512i b0 = _mm512_load_si512(b);
+        const __m512i b1 = _mm512_load_si512(b + 32);
+        INT_AVX512_ROW(0);
+        INT_AVX512_ROW(1);
+        INT_AVX512_ROW(2);
+        INT_AVX512_ROW(3);
+        INT_AVX512_ROW(4);
+        INT_AVX512_ROW(5);
+        INT_AVX512_ROW(6);
+        INT_AVX512_ROW(7);
+        a += 16;
+        b += 64;
+    }
+
+    INT_AVX512_STORE_ROW(0);
+    INT_AVX512_STORE_ROW(1);
+    INT_AVX512_STORE_ROW(2);
+    INT_AVX512_STORE_ROW(3);
+    INT_AVX512_STORE_ROW(4);
+    INT_AVX512_STORE_ROW(5);
+    INT_AVX512_STORE_ROW(6);
+    INT_AVX512_STORE_ROW(7);
+}
+#endif
+
+// Available kernels, from the most to the least preferred one
+static const struct {
+    const char *name;
+    unsigned features;
+    size_t mr, nr;
+    int_ukernel_fn fn;
+} int_kernels[] = {
+#ifdef GEMM_INT_X86
+    {"avx512vnni", CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512VNNI, 8, 32, int_kernel_avx512vnni},
+    {"avx2", CPU_FEATURE_AVX2, 6, 16, int_kernel_avx2},
+#endif
+    {"generic", 0, 4, 8, int_kernel_generic},
+};
+static const size_t num_int_kernels = sizeof(int_kernels) / sizeof(int_kernels[0]);
+
+// Returns the index of the kernel to use; MATMUL_KERNEL selects one by name
+// if it is supported, as for the floating-point kernels
+static size_t select_int_kernel(void) {
+    const char *forced = getenv("MATMUL_KERNEL");
+    for (size_t i = 0; forced && i < num_int_kernels; i++) {
+        if (!strcmp(int_kernels[i].name, forced) && cpu_supports(int_kernels[i].features))
+            return i;
+    }
+    for (size_t i = 0; i < num_int_kernels; i++) {
+        if (cpu_supports(int_kernels[i].features))
+            return i;
+    }
+    return num_int_kernels - 1;
+}
+
+static size_t int_kernel_index(void) {
+    // The selection is idempotent, so concurrent first calls are harmless
+    static int selected = -1;
+    if (selected < 0)
+        selected = (int)select_int_kernel();
+    return (size_t)selected;
+}
+
+const char *gemm_int_kernel_name(void) {
+    return int_kernels[int_kernel_index()].name;
+}
+
+size_t gemm_int_size(gemm_int_type type) {
+    return type == GEMM_INT8 ? sizeof(int8_t) : sizeof(int16_t);
+}
+
+int gemm_int_range(size_t rows, size_t cols, const double *X, size_t ldx, int *absmax) {
+    double max = 0.0;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            const double x = X[i * ldx + j];
+            // Also rejects NaN, which fails every comparison
+            if (!(x >= -INT16_LIMIT && x <= INT16_LIMIT) || x != (double)(int)x)
+                return 0;
+            if (x > max || -x > max)
+                max = x < 0 ? -x : x;
+        }
+    }
+    *absmax = (int)max;
+    return 1;
+}
+
+gemm_int_type gemm_int_type_for(int absmax) {
+    return absmax <= INT8_LIMIT ? GEMM_INT8 : GEMM_INT16;
+}
+
+void gemm_int_convert(size_t rows, size_t cols, const double *X, size_t ldx,
+                      gemm_int_type type, void *dst, size_t ldd) {
+    // Values out of range are saturated instead of wrapped around
+    const double limit = type == GEMM_INT8 ? INT8_LIMIT : INT16_LIMIT;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            double x = X[i * ldx + j];
+            x = x < -limit ? -limit : x > limit ? limit : x;
+            if (type == GEMM_INT8)
+                ((int8_t *)dst)[i * ldd + j] = (int8_t)x;
+            else
+                ((int16_t *)dst)[i * ldd + j] = (int16_t)x;
+        }
+    }
+}
+
+static inline int16_t int_elem(const void *X, gemm_int_type type, size_t idx) {
+    return type == GEMM_INT8 ? ((const int8_t *)X)[idx] : ((const int16_t *)X)[idx];
+}
+
+// Packs a mc x kc block of A into micro-panels of mr rows of k pairs (zero-padded)
+static void pack_a(size_t mc, size_t kc, const void *A, gemm_int_type type, size_t lda,
+                   size_t mr, int16_t *Ap) {
+    const size_t kp = (kc + 1) / 2;
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        const size_t rows = MIN(mr, mc - ir);
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t k = 0; k < kc; k++)
+                Ap[((k / 2) * mr + i) * 2 + k % 2] = int_elem(A, type, (ir + i) * lda + k);
+            if (kc % 2)
+                Ap[((kc / 2) * mr + i) * 2 + 1] = 0;
+        }
+        for (size_t q = 0; q < kp; q++)
+            for (size_t i = rows; i < mr; i++)
+                Ap[(q * mr + i) * 2] = Ap[(q * mr + i) * 2 + 1] = 0;
+        Ap += mr * kp * 2;
+    }
+}
+
+// Packs a kc x nc panel of B into micro-panels of nr columns of k pairs (zero-padded)
+static void pack_b(size_t kc, size_t nc, const void *B, gemm_int_type type, size_t ldb,
+                   size_t nr, int16_t *Bp) {
+    const size_t kp = (kc + 1) / 2;
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        const size_t cols = MIN(nr, nc - jr);
+        for (size_t k = 0; k < kc; k++)
+            for (size_t j = 0; j < cols; j++)
+                Bp[((k / 2) * nr + j) * 2 + k % 2] = int_elem(B, type, k * ldb + jr + j);
+        if (kc % 2)
+            for (size_t j = 0; j < cols; j++)
+                Bp[((kc / 2) * nr + j) * 2 + 1] = 0;
+        for (size_t q = 0; q < kp; q++)
+            for (size_t j = cols; j < nr; j++)
+                Bp[(q * nr + j) * 2] = Bp[(q * nr + j) * 2 + 1] = 0;
+        Bp += nr * kp * 2;
+    }
+}
+
+// Multiplies the packed block of A by the packed panel of B using the micro-kernel
+static void macro_kernel(size_t kern, size_t mc, size_t nc, size_t kc,
+                         const int16_t *Ap, const int16_t *Bp,
+                         int accumulate, double *C, size_t ldc) {
+    const size_t MR = int_kernels[kern].mr, NR = int_kernels[kern].nr;
+    const int_ukernel_fn fn = int_kernels[kern].fn;
+    const size_t kp = (kc + 1) / 2;
+    double tile[INT_MAX_MR * INT_MAX_NR];
+
+    for (size_t jr = 0; jr < nc; jr += NR) {
+        const size_t nr = MIN(NR, nc - jr);
+        for (size_t ir = 0; ir < mc; ir += MR) {
+            const size_t mr = MIN(MR, mc - ir);
+            const int16_t *a = &Ap[ir * kp * 2];
+            const int16_t *b = &Bp[jr * kp * 2];
+            double *c = &C[ir * ldc + jr];
+            if (mr == MR && nr == NR) {
+                fn(kp, a, b, c, ldc, accumulate);
+            } else {
+                fn(kp, a, b, tile, NR, 0);
+                for (size_t i = 0; i < mr; i++)
+                    for (size_t j = 0; j < nr; j++)
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i * NR + j] : tile[i * NR + j];
+            }
+        }
+    }
+}
+
+// Computes the product without packing buffers, accumulating in int64; used
+// when the buffers cannot be allocated
+static void gemm_int_unpacked(size_t m, size_t n, size_t p,
+                              gemm_int_type typeA, const void *A, size_t lda,
+                              gemm_int_type typeB, const void *B, size_t ldb,
+                              double *C, size_t ldc) {
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            int64_t sum = 0;
+            for (size_t k = 0; k < p; k++)
+                sum += int_elem(A, typeA, i * lda + k) * int_elem(B, typeB, k * ldb + j);
+            C[i * ldc + j] = (double)sum;
+        }
+    }
+}
+
+void gemm_int(size_t m, size_t n, size_t p,
+              gemm_int_type typeA, const void *A, size_t lda, int amax,
+              gemm_int_type typeB, const void *B, size_t ldb, int bmax,
+              double *C, size_t ldc) {
+    const size_t kern = int_kernel_index();
+    const size_t mr = int_kernels[kern].mr, nr = int_kernels[kern].nr;
+
+    if (m == 0 || n == 0)
+        return;
+    if (p == 0) {
+        for (size_t i = 0; i < m; i++)
+            memset(&C[i * ldc], 0, n * sizeof(double));
+        return;
+    }
+
+    // Deepest block whose int32 sums cannot overflow (always at least one pair)
+    size_t kb = KC;
+    const int64_t bound = (int64_t)amax * bmax;
+    if (bound > 0 && (int64_t)INT32_MAX / bound < KC)
+        kb = (size_t)((int64_t)INT32_MAX / bound) / 2 * 2;
+
+    // Packing buffers, sized for the largest block of this problem
+    const size_t mc_max = MIN(MC, ROUND_UP(m, mr));
+    const size_t nc_max = MIN(NC, ROUND_UP(n, nr));
+    const size_t kc_max = ROUND_UP(MIN(kb, p), 2);
+    int16_t *Ap = (int16_t *)new_buffer(mc_max * kc_max * sizeof(int16_t));
+    int16_t *Bp = (int16_t *)new_buffer(kc_max * nc_max * sizeof(int16_t));
+    if (!Ap || !Bp) {
+        delete_buffer(Ap);
+        delete_buffer(Bp);
+        gemm_int_unpacked(m, n, p, typeA, A, lda, typeB, B, ldb, C, ldc);
+        return;
+    }
+
+    const size_t sizeA = gemm_int_size(typeA), sizeB = gemm_int_size(typeB);
+    for (size_t jc = 0; jc < n; jc += NC) {
+        const size_t nc = MIN(NC, n - jc);
+        for (size_t pc = 0; pc < p; pc += kb) {
+            const size_t kc = MIN(kb, p - pc);
+            pack_b(kc, nc, (const char *)B + (pc * ldb + jc) * sizeB, typeB, ldb, nr, Bp);
+            for (size_t ic = 0; ic < m; ic += MC) {
+                const size_t mc = MIN(MC, m - ic);
+                pack_a(mc, kc, (const char *)A + (ic * lda + pc) * sizeA, typeA, lda, mr, Ap);
+                macro_kernel(kern, mc, nc, kc, Ap, Bp, pc != 0, &C[ic * ldc + jc], ldc);
+            }
+        }
+    }
+
+    delete_buffer(Ap);
+    delete_buffer(Bp);
+}
+
+static size_t range_hint = 0;
+
+void matmul_int_set_range(size_t absmax) {
+    range_hint = absmax;
+}
+
+// C (m x n) = A (m x p) * B (p x n)
+void matmul_int(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    const size_t lda = matrix_ld(A, m, p), ldb = matrix_ld(B, p, n);
+    int amax, bmax;
+    if (range_hint) {
+        if (range_hint > INT16_LIMIT) {
+            matmul_packed(m, n, p, A, B, C);
+            return;
+        }
+        amax = bmax = (int)range_hint;
+    } else if (!gemm_int_range(m, p, A[0], lda, &amax) || !gemm_int_range(p, n, B[0], ldb, &bmax)) {
+        matmul_packed(m, n, p, A, B, C);
+        return;
+    }
+
+    // The integer copies are stored without padding
+    const gemm_int_type typeA = gemm_int_type_for(amax), typeB = gemm_int_type_for(bmax);
+    void *Ai = new_buffer(m * p * gemm_int_size(typeA));
+    void *Bi = new_buffer(p * n * gemm_int_size(typeB));
+    if (!Ai || !Bi) {
+        delete_buffer(Ai);
+        delete_buffer(Bi);
+        matmul_packed(m, n, p, A, B, C);
+        return;
+    }
+    gemm_int_convert(m, p, A[0], lda, typeA, Ai, p);
+    gemm_int_convert(p, n, B[0], ldb, typeB, Bi, n);
+    gemm_int(m, n, p, typeA, Ai, p, amax, typeB, Bi, n, bmax, C[0], matrix_ld(C, m, n));
+
+    delete_buffer(Ai);
+    delete_buffer(Bi);
+}
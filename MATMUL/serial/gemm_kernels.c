@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <string.h>
+#include <cpu_features.h>
+#include <gemm_kernel.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GEMM_X86 1
+#include <immintrin.h>
+#endif
+
+// Portable kernel (4 x 8), relies on the compiler for vectorization
+static void kernel_generic(size_t kc, const double *restrict a, const double *restrict b,
+                           double alpha, double *restrict c, size_t ldc, double beta) {
+    double acc[4][8] = {{0.0}};
+
+    for (size_t k = 0; k < kc; k++) {
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 8; j++)
+                acc[i][j] += a[i] * b[j];
+        a += 4;
+        b += 8;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (beta == 0.0)
+                c[i * ldc + j] = alpha * acc[i][j];
+            else
+                c[i * ldc + j] = alpha * acc[i][j] + beta * c[i * ldc + j];
+        }
+    }
+}
+
+#ifdef GEMM_X86
+// SSE2 kernel (6 x 4): 12 accumulators of 2 doubles
+TARGET_SSE2 static inline void store_sse2(double *c, __m128d acc, double alpha, double beta) {
+    if (alpha != 1.0)
+        acc = _mm_mul_pd(_mm_set1_pd(alpha), acc);
+    if (beta == 0.0)
+        _mm_storeu_pd(c, acc);
+    else
+        _mm_storeu_pd(c, _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(beta), _mm_loadu_pd(c))));
+}
+
+#define SSE2_ROW(r)                                          \
+    do {                                                     \
+        const __m128d ar = _mm_load1_pd(a + r);              \
+        c##r##_0 = _mm_add_pd(c##r##_0, _mm_mul_pd(ar, b0)); \
+        c##r##_1 = _mm_add_pd(c##r##_1, _mm_mul_pd(ar, b1)); \
+    } while (0)
+
+#define SSE2_STORE_ROW(r)                                   \
+    do {                                                    \
+        store_sse2(c + r * ldc, c##r##_0, alpha, beta);     \
+        store_sse2(c + r * ldc + 2, c##r##_1, alpha, beta); \
+    } while (0)
+
+TARGET_SSE2 static void kernel_sse2(size_t kc, const double *restrict a, const double *restrict b,
+                                    double alpha, double *restrict c, size_t ldc, double beta) {
+    __m128d c0_0 = _mm_setzero_pd(), c0_1 = _mm_setzero_pd();
+    __m128d c1_0 = _mm_setzero_pd(), c1_1 = _mm_setzero_pd();
+    __m128d c2_0 = _mm_setzero_pd(), c2_1 = _mm_setzero_pd();
+    __m128d c3_0 = _mm_setzero_pd(), c3_1 = _mm_setzero_pd();
+    __m128d c4_0 = _mm_setzero_pd(), c4_1 = _mm_setzero_pd();
+    __m128d c5_0 = _mm_setzero_pd(), c5_1 = _mm_setzero_pd();
+
+    for (size_t k = 0; k < kc; k++) {
+        const __m128d b0 = _mm_load_pd(b);
+        const __m128d b1 = _mm_load_pd(b + 2);
+        SSE2_ROW(0);
+        SSE2_ROW(1);
+        SSE2_ROW(2);
+        SSE2_ROW(3);
+        SSE2_ROW(4);
+        SSE2_ROW(5);
+        a += 6;
+        b += 4;
+    }
+
+    SSE2_STORE_ROW(0);
+    SSE2_STORE_ROW(1);
+    SSE2_STORE_ROW(2);
+    SSE2_STORE_ROW(3);
+    SSE2_STORE_ROW(4);
+    SSE2_STORE_ROW(5);
+}
+
+// AVX2 + FMA kernel (6 x 8): 12 accumulators of 4 doubles
+TARGET_AVX2 static inline void store_avx2(double *c, __m256d acc, double alpha, double beta) {
+    if (alpha != 1.0)
+        acc = _mm256_mul_pd(_mm256_set1_pd(alpha), acc);
+    if (beta == 0.0)
+        _mm256_storeu_pd(c, acc);
+    else
+        _mm256_storeu_pd(c, _mm256_fmadd_pd(_mm256_set1_pd(beta), _mm256_loadu_pd(c), acc));
+}
+
+#define AVX2_ROW(r)                                    \
+    do {                                               \
+        const __m256d ar = _mm256_broadcast_sd(a + r); \
+        c##r##_0 = _mm256_fmadd_pd(ar, b0, c##r##_0);  \
+        c##r##_1 = _mm256_fmadd_pd(ar, b1, c##r##_1);  \
+    } while (0)
+
+#define AVX2_STORE_ROW(r)                                   \
+    do {                                                    \
+        store_avx2(c + r * ldc, c##r##_0, alpha, beta);     \
+        store_avx2(c + r * ldc + 4, c##r##_1, alpha, beta); \
+    } while (0)
+
+TARGET_AVX2 static void kernel_avx2(size_t kc, const double *restrict a, const double *restrict b,
+                                    double alpha, double *restrict c, size_t ldc, double beta) {
+    __m256d c0_0 = _mm256_setzero_pd(), c0_1 = _mm256_setzero_pd();
+    __m256d c1_0 = _mm256_setzero_pd(), c1_1 = _mm256_setzero_pd();
+    __m256d c2_0 = _mm256_setzero_pd(), c2_1 = _mm256_setzero_pd();
+    __m256d c3_0 = _mm256_setzero_pd(), c3_1 = _mm256_setzero_pd();
+    __m256d c4_0 = _mm256_setzero_pd(), c4_1 = _mm256_setzero_pd();
+    __m256d c5_0 = _mm256_setzero_pd(), c5_1 = _mm256_setzero_pd();
+
+    for (size_t k = 0; k < kc; k++) {
+        const __m256d b0 = _mm256_load_pd(b);
+        const __m256d b1 = _mm256_load_pd(b + 4);
+        AVX2_ROW(0);
+        AVX2_ROW(1);
+        AVX2_ROW(2);
+        AVX2_ROW(3);
+        AVX2_ROW(4);
+        AVX2_ROW(5);
+        a += 6;
+        b += 8;
+    }
+
+    AVX2_STORE_ROW(0);
+    AVX2_STORE_ROW(1);
+    AVX2_STORE_ROW(2);
+    AVX2_STORE_ROW(3);
+    AVX2_STORE_ROW(4);
+    AVX2_STORE_ROW(5);
+}
+
+// AVX-512 kernel (12 x 16): 24 accumulators of 8 doubles
+TARGET_AVX512 static inline void store_avx512(double *c, __m512d acc, double alpha, double beta) {
+    if (alpha != 1.0)
+        acc = _mm512_mul_pd(_mm512_set1_pd(alpha), acc);
+    if (beta == 0.0)
+        _mm512_storeu_pd(c, acc);
+    else
+        _mm512_storeu_pd(c, _mm512_fmadd_pd(_mm512_set1_pd(beta), _mm512_loadu_pd(c), acc));
+}
+
+#define AVX512_ROW(r)                                 \
+    do {                                              \
+        const __m512d ar = _mm512_set1_pd(a[r]);      \
+        c##r##_0 = _mm512_fmadd_pd(ar, b0, c##r##_0); \
+        c##r##_1 = _mm512_fmadd_pd(ar, b1, c##r##_1); \
+    } while (0)
+
+#define AVX512_STORE_ROW(r)                                   \
+    do {                                                      \
+        store_avx512(c + r * ldc, c##r##_0, alpha, beta);     \
+        store_avx512(c + r * ldc + 8, c##r##_1, alpha, beta); \
+    } while (0)
+
+TARGET_AVX512 static void kernel_avx512(size_t kc, const double *restrict a, const double *restrict b,
+                                        double alpha, double *restrict c, size_t ldc, double beta) {
+    __m512d c0_0 = _mm512_setzero_pd(), c0_1 = _mm512_setzero_pd();
+    __m512d c1_0 = _mm512_setzero_pd(), c1_1 = _mm512_setzero_pd();
+    __m512d c2_0 = _mm512_setzero_pd(), c2_1 = _mm512_setzero_pd();
+    __m512d c3_0 = _mm512_setzero_pd(), c3_1 = _mm512_setzero_pd();
+    __m512d c4_0 = _mm512_setzero_pd(), c4_1 = _mm512_setzero_pd();
+    __m512d c5_0 = _mm512_setzero_pd(), c5_1 = _mm512_setzero_pd();
+    __m512d c6_0 = _mm512_setzero_pd(), c6_1 = _mm512_setzero_pd();
+    __m512d c7_0 = _mm512_setzero_pd(), c7_1 = _mm512_setzero_pd();
+    __m512d c8_0 = _mm512_setzero_pd(), c8_1 = _mm512_setzero_pd();
+    __m512d c9_0 = _mm512_setzero_pd(), c9_1 = _mm512_setzero_pd();
+    __m512d c10_0 = _mm512_setzero_pd(), c10_1 = _mm512_setzero_pd();
+    __m512d c11_0 = _mm512_setzero_pd(), c11_1 = _mm512_setzero_pd();
+
+    for (size_t k = 0; k < kc; k++) {
+        const __m512d b0 = _mm512_load_pd(b);
+        const __m512d b1 = _mm512_load_pd(b + 8);
+        AVX512_ROW(0);
+        AVX512_ROW(1);
+        AVX512_ROW(2);
+        AVX512_ROW(3);
+        AVX512_ROW(4);
+        AVX512_ROW(5);
+        AVX512_ROW(6);
+        AVX512_ROW(7);
+        AVX512_ROW(8);
+        AVX512_ROW(9);
+        AVX512_ROW(10);
+        AVX512_ROW(11);
+        a += 12;
+        b += 16;
+    }
+
+    AVX512_STORE_ROW(0);
+    AVX512_STORE_ROW(1);
+    AVX512_STORE_ROW(2);
+    AVX512_STORE_ROW(3);
+    AVX512_STORE_ROW(4);
+    AVX512_STORE_ROW(5);
+    AVX512_STORE_ROW(6);
+    AVX512_STORE_ROW(7);
+    AVX512_STORE_ROW(8);
+    AVX512_STORE_ROW(9);
+    AVX512_STORE_ROW(10);
+    AVX512_STORE_ROW(11);
+}
+#endif
+
+// Available kernels, from the most to the least preferred one
+static const struct {
+    unsigned features;
+    gemm_kernel kernel;
+} kernels[] = {
+#ifdef GEMM_X86
+    {CPU_FEATURE_AVX512F, {"avx512", 12, 16, 144, 256, 4096, kernel_avx512}},
+    {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, {"avx2", 6, 8, 96, 256, 4096, kernel_avx2}},
+    {CPU_FEATURE_SSE2, {"sse2", 6, 4, 96, 256, 4096, kernel_sse2}},
+#endif
+    {0, {"generic", 4, 8, 96, 256, 4096, kernel_generic}},
+};
+static const size_t num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+const gemm_kernel *gemm_kernel_find(const char *name) {
+    for (size_t i = 0; i < num_kernels; i++) {
+        if (!strcmp(kernels[i].kernel.name, name))
+            return cpu_supports(kernels[i].features) ? &kernels[i].kernel : NULL;
+    }
+    return NULL;
+}
+
+static const gemm_kernel *select_kernel(void) {
+    const char *forced = getenv("MATMUL_KERNEL");
+    if (forced) {
+        const gemm_kernel *kernel = gemm_kernel_find(forced);
+        if (kernel)
+            return kernel;
+        fprintf(stderr, "Warning: kernel '%s' is not available, using the default one\n", forced);
+    }
+
+    for (size_t i = 0; i < num_kernels; i++) {
+        if (cpu_supports(kernels[i].features))
+            return &kernels[i].kernel;
+    }
+    return &kernels[num_kernels - 1].kernel;
+}
+
+const gemm_kernel *gemm_kernel_get(void) {
+    // The selection is idempotent, so concurrent first calls are harmless
+    static const gemm_kernel *selected = NULL;
+    if (!selected)
+        selected = select_kernel();
+    return selected;
+}
@@ -0,0 +1,135 @@
+#include <string.h>
+#include <gemm.h>
+#include <matrix.h>
+
+// Register tile of the leaf kernel
+#define LEAF_MR 4
+#define LEAF_NR 8
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Dimensions shared by every leaf: the blocks of A are bm x bp, the blocks of
+// B are bp x bn and the blocks of C are bm x bn
+typedef struct leaf_dims {
+    size_t m, n, p;    // Elements of each dimension
+    size_t bm, bn, bp; // Block size along each dimension
+} leaf_dims;
+
+// Elements of the block of index b along a dimension, zero past its end
+static size_t extent(size_t dim, size_t block, size_t b) {
+    return b * block < dim ? MIN(block, dim - b * block) : 0;
+}
+
+// Accumulates a full MR x NR tile of C in registers
+static void micro_kernel(size_t kc, const double *restrict a, size_t lda,
+                         const double *restrict b, size_t ldb,
+                         double *restrict c, size_t ldc) {
+    double acc[LEAF_MR][LEAF_NR] = {{0.0}};
+
+    for (size_t k = 0; k < kc; k++) {
+        for (int i = 0; i < LEAF_MR; i++) {
+            const double aik = a[i * lda + k];
+            for (int j = 0; j < LEAF_NR; j++)
+                acc[i][j] += aik * b[k * ldb + j];
+        }
+    }
+
+    for (int i = 0; i < LEAF_MR; i++)
+        for (int j = 0; j < LEAF_NR; j++)
+            c[i * ldc + j] += acc[i][j];
+}
+
+// Accumulates a partial mr x nr tile of C found at the edges of a block
+static void edge_kernel(size_t mr, size_t nr, size_t kc, const double *a, size_t lda,
+                        const double *b, size_t ldb, double *c, size_t ldc) {
+    for (size_t i = 0; i < mr; i++)
+        for (size_t k = 0; k < kc; k++)
+            for (size_t j = 0; j < nr; j++)
+                c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
+}
+
+// C(bi, bj) += A(bi, bk) * B(bk, bj) over the elements inside the matrices
+static void leaf(const leaf_dims *d, size_t bi, size_t bj, size_t bk,
+                 const double *A, const double *B, double *C) {
+    const size_t m = extent(d->m, d->bm, bi);
+    const size_t n = extent(d->n, d->bn, bj);
+    const size_t p = extent(d->p, d->bp, bk);
+    if (!m || !n || !p)
+        return;
+
+    for (size_t i = 0; i < m; i += LEAF_MR) {
+        const size_t mr = MIN(LEAF_MR, m - i);
+        for (size_t j = 0; j < n; j += LEAF_NR) {
+            const size_t nr = MIN(LEAF_NR, n - j);
+            if (mr == LEAF_MR && nr == LEAF_NR)
+                micro_kernel(p, &A[i * d->bp], d->bp, &B[j], d->bn, &C[i * d->bn + j], d->bn);
+            else
+                edge_kernel(mr, nr, p, &A[i * d->bp], d->bp, &B[j], d->bn, &C[i * d->bn + j], d->bn);
+        }
+    }
+}
+
+/*   Cache-oblivious recursion (Frigo et al., 1999)
+
+     The operands are regions of 2^m x 2^p, 2^p x 2^n and 2^m x 2^n blocks,
+     and the largest of m, n and p is halved until every region is a single
+     block. The halves of each region are contiguous in the Morton order, so
+     at some depth the working set of the recursion fits in each cache level,
+     whatever its size. (bi, bj, bk) is the first block of the regions.
+*/
+static void multiply(const leaf_dims *d, unsigned m, unsigned n, unsigned p,
+                     size_t bi, size_t bj, size_t bk,
+                     const double *A, const double *B, double *C) {
+    if (m >= n && m >= p && m > 0) {
+        // Top and bottom halves of A and C
+        const size_t half_a = (d->bm * d->bp) << (m - 1 + p);
+        const size_t half_c = (d->bm * d->bn) << (m - 1 + n);
+        multiply(d, m - 1, n, p, bi, bj, bk, A, B, C);
+        multiply(d, m - 1, n, p, bi + ((size_t)1 << (m - 1)), bj, bk, A + half_a, B, C + half_c);
+    } else if (n > m && n > p) {
+        // Left and right halves of B and C
+        const size_t half_b = (d->bp * d->bn) << (p + n - 1);
+        const size_t half_c = (d->bm * d->bn) << (m + n - 1);
+        multiply(d, m, n - 1, p, bi, bj, bk, A, B, C);
+        multiply(d, m, n - 1, p, bi, bj + ((size_t)1 << (n - 1)), bk, A, B + half_b, C + half_c);
+    } else if (p > 0) {
+        // Left half of A times top half of B, then the right and bottom ones
+        const size_t half_a = (d->bm * d->bp) << (m + p - 1);
+        const size_t half_b = (d->bp * d->bn) << (p - 1 + n);
+        multiply(d, m, n, p - 1, bi, bj, bk, A, B, C);
+        multiply(d, m, n, p - 1, bi, bj, bk + ((size_t)1 << (p - 1)), A + half_a, B + half_b, C);
+    } else {
+        leaf(d, bi, bj, bk, A, B, C);
+    }
+}
+
+// C (m x n) = A (m x p) * B (p x n) over matrices stored in Morton order
+int gemm_morton(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C) {
+    if (A->rows != C->rows || B->cols != C->cols || A->cols != B->rows)
+        return 0;
+
+    const leaf_dims d = {C->rows, C->cols, A->cols, C->block_rows, C->block_cols, A->block_cols};
+    const size_t blocks = (size_t)1 << (C->levels_rows + C->levels_cols);
+    memset(C->data, 0, blocks * d.bm * d.bn * sizeof(double));
+    multiply(&d, C->levels_rows, C->levels_cols, A->levels_cols, 0, 0, 0, A->data, B->data, C->data);
+    return 1;
+}
+
+// C (m x n) = A (m x p) * B (p x n), converting the operands to Morton order
+void matmul_morton(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    MortonMatrix *a = new_morton(m, p);
+    MortonMatrix *b = new_morton(p, n);
+    MortonMatrix *c = new_morton(m, n);
+    if (a && b && c) {
+        to_morton(A, a);
+        to_morton(B, b);
+        gemm_morton(a, b, c);
+        from_morton(c, C);
+    } else {
+        // Without memory for the copies, the row-major operands are used instead
+        matmul_blocked(m, n, p, A, B, C);
+    }
+    delete_morton(a);
+    delete_morton(b);
+    delete_morton(c);
+}
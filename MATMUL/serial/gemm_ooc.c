@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include <string.h>
+#include <clock.h>
+#include <gemm.h>
+#include <gemm_ooc.h>
+#include <matrix.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OOC_HAS_MMAP 1
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Tiles are multiples of TILE_ALIGN, and their buffers are padded by LD_PAD so
+// that their leading dimension is not a multiple of a large power of two
+#define TILE_ALIGN 64
+#define LD_PAD 8
+
+// Double-buffered tiles of A, B and C
+#define TILE_BUFFERS 6
+
+// Rows per chunk when streaming a whole matrix
+#define STREAM_ROWS 64
+
+#ifdef OOC_HAS_MMAP
+static ooc_matrix *map_file(const char *path, size_t rows, size_t cols, int create) {
+    if (rows < 1 || cols < 1)
+        return NULL;
+
+    ooc_matrix *mat = (ooc_matrix *)calloc(1, sizeof(ooc_matrix));
+    if (!mat)
+        return NULL;
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->bytes = rows * cols * sizeof(double);
+
+    mat->fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    if (mat->fd < 0) {
+        free(mat);
+        return NULL;
+    }
+    // A new file is sparse: its blocks are only allocated when they are written
+    struct stat st;
+    if ((create && ftruncate(mat->fd, (off_t)mat->bytes)) ||
+        fstat(mat->fd, &st) || (size_t)st.st_size < mat->bytes) {
+        close(mat->fd);
+        free(mat);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, mat->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mat->fd, 0);
+    if (data == MAP_FAILED) {
+        close(mat->fd);
+        free(mat);
+        return NULL;
+    }
+    mat->data = (double *)data;
+    return mat;
+}
+
+// Drops the pages mapping the selected elements from the address space; they
+// remain in the page cache (dirty ones are written back by the kernel)
+static void release_range(const ooc_matrix *mat, size_t first, size_t count) {
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)&mat->data[first];
+    uintptr_t end = (uintptr_t)&mat->data[first + count];
+    begin = begin / page * page;
+    madvise((void *)begin, end - begin, MADV_DONTNEED);
+}
+
+// Asks the kernel to start reading the selected elements in the background
+static void prefetch_range(const ooc_matrix *mat, size_t first, size_t count) {
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)&mat->data[first];
+    uintptr_t end = (uintptr_t)&mat->data[first + count];
+    begin = begin / page * page;
+    madvise((void *)begin, end - begin, MADV_WILLNEED);
+}
+#endif
+
+ooc_matrix *ooc_create(const char *path, size_t rows, size_t cols) {
+#ifdef OOC_HAS_MMAP
+    return map_file(path, rows, cols, 1);
+#else
+    (void)path, (void)rows, (void)cols;
+    return NULL;
+#endif
+}
+
+ooc_matrix *ooc_open(const char *path, size_t rows, size_t cols) {
+#ifdef OOC_HAS_MMAP
+    return map_file(path, rows, cols, 0);
+#else
+    (void)path, (void)rows, (void)cols;
+    return NULL;
+#endif
+}
+
+void ooc_close(ooc_matrix *mat) {
+#ifdef OOC_HAS_MMAP
+    if (!mat)
+        return;
+    munmap(mat->data, mat->bytes);
+    close(mat->fd);
+    free(mat);
+#else
+    (void)mat;
+#endif
+}
+
+void ooc_rand(ooc_matrix *mat) {
+#ifdef OOC_HAS_MMAP
+    for (size_t row = 0; row < mat->rows; row += STREAM_ROWS) {
+        const size_t first = row * mat->cols;
+        const size_t count = MIN(STREAM_ROWS, mat->rows - row) * mat->cols;
+        for (size_t e = first; e < first + count; e++)
+            mat->data[e] = rand() % 10;
+        release_range(mat, first, count);
+    }
+#else
+    (void)mat;
+#endif
+}
+
+double ooc_checksum(const ooc_matrix *mat) {
+    double sum = 0.0;
+#ifdef OOC_HAS_MMAP
+    for (size_t row = 0; row < mat->rows; row += STREAM_ROWS) {
+        const size_t first = row * mat->cols;
+        const size_t count = MIN(STREAM_ROWS, mat->rows - row) * mat->cols;
+        prefetch_range(mat, first, count);
+        for (size_t e = first; e < first + count; e++)
+            sum += mat->data[e];
+        release_range(mat, first, count);
+    }
+#else
+    (void)mat;
+#endif
+    return sum;
+}
+
+// Memory needed by the tile buffers of gemm_ooc()
+static size_t tile_bytes(size_t tile) {
+    return TILE_BUFFERS * tile * (tile + LD_PAD) * sizeof(double);
+}
+
+size_t gemm_ooc_tile(size_t budget) {
+    if (tile_bytes(TILE_ALIGN) > budget)
+        return 0;
+    size_t tile = TILE_ALIGN;
+    while (tile_bytes(tile + TILE_ALIGN) <= budget)
+        tile += TILE_ALIGN;
+    return tile;
+}
+
+#ifdef OOC_HAS_MMAP
+// Copies a rows x cols tile of the matrix beginning at (r0, c0) to a buffer
+static void load_tile(const ooc_matrix *mat, size_t r0, size_t c0, size_t rows, size_t cols,
+                      double *buf, size_t ld) {
+    // All the rows are requested at once so that the kernel reads them in parallel
+    for (size_t i = 0; i < rows; i++)
+        prefetch_range(mat, (r0 + i) * mat->cols + c0, cols);
+    for (size_t i = 0; i < rows; i++)
+        memcpy(&buf[i * ld], &mat->data[(r0 + i) * mat->cols + c0], cols * sizeof(double));
+    release_range(mat, r0 * mat->cols + c0, (rows - 1) * mat->cols + cols);
+}
+
+// Copies a rows x cols tile from a buffer to the matrix beginning at (r0, c0)
+static void store_tile(ooc_matrix *mat, size_t r0, size_t c0, size_t rows, size_t cols,
+                       const double *buf, size_t ld) {
+    for (size_t i = 0; i < rows; i++)
+        memcpy(&mat->data[(r0 + i) * mat->cols + c0], &buf[i * ld], cols * sizeof(double));
+    release_range(mat, r0 * mat->cols + c0, (rows - 1) * mat->cols + cols);
+}
+#endif
+
+int gemm_ooc(const ooc_matrix *A, const ooc_matrix *B, ooc_matrix *C,
+             size_t budget, gemm_ooc_stats *stats) {
+#ifdef OOC_HAS_MMAP
+    const size_t m = C->rows, n = C->cols, p = A->cols;
+    if (A->rows != m || B->rows != p || B->cols != n)
+        return 0;
+
+    // Tiles are not larger than the matrices need
+    const size_t dim = MAX(m, MAX(n, p));
+    const size_t tile = MIN(gemm_ooc_tile(budget), (dim + TILE_ALIGN - 1) / TILE_ALIGN * TILE_ALIGN);
+    if (!tile)
+        return 0;
+    const size_t ld = tile + LD_PAD;
+    double *buffers = (double *)new_buffer(TILE_BUFFERS * tile * ld * sizeof(double));
+    if (!buffers)
+        return 0;
+    double *a[2] = {&buffers[0 * tile * ld], &buffers[1 * tile * ld]};
+    double *b[2] = {&buffers[2 * tile * ld], &buffers[3 * tile * ld]};
+    double *c[2] = {&buffers[4 * tile * ld], &buffers[5 * tile * ld]};
+
+    // Each step multiplies the tiles A(ti, tk) and B(tk, tj) into the tile C(ti, tj);
+    // the steps of a tile of C are consecutive, so it is written back once
+    const size_t tiles_m = (m + tile - 1) / tile;
+    const size_t tiles_n = (n + tile - 1) / tile;
+    const size_t tiles_p = (p + tile - 1) / tile;
+    const size_t steps = tiles_m * tiles_n * tiles_p;
+    double compute_time = 0.0, io_time = 0.0, io_bytes = 0.0;
+
+    // A team of two threads: the first one computes and the last one performs
+    // the I/O of the next step; a single thread does both in turn
+#pragma omp parallel num_threads(2)
+    {
+#ifdef _OPENMP
+        const int tid = omp_get_thread_num(), last = omp_get_num_threads() - 1;
+#else
+        const int tid = 0, last = 0;
+#endif
+        for (size_t s = 0; s <= steps; s++) {
+            if (tid == last) {
+                double time_start = getClock();
+                // Reads the tiles of the next step
+                if (s < steps) {
+                    const size_t t = s / tiles_p, tk = s % tiles_p;
+                    const size_t i0 = t / tiles_n * tile, j0 = t % tiles_n * tile, k0 = tk * tile;
+                    const size_t rows = MIN(tile, m - i0), cols = MIN(tile, n - j0);
+                    const size_t depth = MIN(tile, p - k0);
+                    load_tile(A, i0, k0, rows, depth, a[s % 2], ld);
+                    load_tile(B, k0, j0, depth, cols, b[s % 2], ld);
+                    io_bytes += (double)(rows + cols) * depth * sizeof(double);
+                }
+                // Writes back the tile of C completed by the previous step
+                if (s > 1 && (s - 1) % tiles_p == 0) {
+                    const size_t t = (s - 2) / tiles_p;
+                    const size_t i0 = t / tiles_n * tile, j0 = t % tiles_n * tile;
+                    const size_t rows = MIN(tile, m - i0), cols = MIN(tile, n - j0);
+                    store_tile(C, i0, j0, rows, cols, c[t % 2], ld);
+                    io_bytes += (double)rows * cols * sizeof(double);
+                }
+                io_time += getClock() - time_start;
+            }
+            if (tid == 0 && s > 0) {
+                // Multiplies the tiles read in the previous step
+                double time_start = getClock();
+                const size_t t = (s - 1) / tiles_p, tk = (s - 1) % tiles_p;
+                const size_t i0 = t / tiles_n * tile, j0 = t % tiles_n * tile, k0 = tk * tile;
+                gemm_packed(MIN(tile, m - i0), MIN(tile, n - j0), MIN(tile, p - k0),
+                            a[(s - 1) % 2], ld, b[(s - 1) % 2], ld,
+                            tk == 0 ? 0.0 : 1.0, c[t % 2], ld);
+                compute_time += getClock() - time_start;
+            }
+#pragma omp barrier
+        }
+
+        // Writes back the last tile of C
+        if (tid == last) {
+            double time_start = getClock();
+            const size_t t = (steps - 1) / tiles_p;
+            const size_t i0 = t / tiles_n * tile, j0 = t % tiles_n * tile;
+            const size_t rows = MIN(tile, m - i0), cols = MIN(tile, n - j0);
+            store_tile(C, i0, j0, rows, cols, c[t % 2], ld);
+            io_bytes += (double)rows * cols * sizeof(double);
+            io_time += getClock() - time_start;
+        }
+    }
+
+    delete_buffer(buffers);
+    if (stats) {
+        stats->tile = tile;
+        stats->compute_time = compute_time;
+        stats->io_time = io_time;
+        stats->io_bytes = io_bytes;
+    }
+    return 1;
+#else
+    (void)A, (void)B, (void)C, (void)budget, (void)stats;
+    return 0;
+#endif
+}
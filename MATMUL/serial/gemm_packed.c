@@ -0,0 +1,373 @@
+#include <math.h>
+#include <gemm.h>
+#include <gemm_kernel.h>
+#include <gemm_prepared.h>
+#include <matrix.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define ROUND_UP(x, m) (((x) + (m) - 1) / (m) * (m))
+
+/*   Operands are addressed through a row stride (rs) and a column stride (cs):
+     element (i, j) of X is X[i * rs + j * cs]. A row-major matrix has rs = ld
+     and cs = 1, and a column-major or transposed one has rs = 1 and cs = ld.
+     The packing routines walk whichever dimension is contiguous in memory.
+*/
+
+// Packs a mc x kc block of A into micro-panels of mr rows (zero-padded)
+void gemm_pack_a(size_t mc, size_t kc, const double *A, size_t rsa, size_t csa,
+                 size_t mr, double *Ap) {
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        const size_t rows = MIN(mr, mc - ir);
+        if (csa == 1) {
+            for (size_t i = 0; i < rows; i++) {
+                const double *a = &A[(ir + i) * rsa];
+                for (size_t k = 0; k < kc; k++)
+                    Ap[k * mr + i] = a[k];
+            }
+        } else {
+            for (size_t k = 0; k < kc; k++) {
+                const double *a = &A[ir * rsa + k * csa];
+                for (size_t i = 0; i < rows; i++)
+                    Ap[k * mr + i] = a[i * rsa];
+            }
+        }
+        for (size_t i = rows; i < mr; i++)
+            for (size_t k = 0; k < kc; k++)
+                Ap[k * mr + i] = 0.0;
+        Ap += mr * kc;
+    }
+}
+
+// Packs a kc x nc panel of B into micro-panels of nr columns (zero-padded)
+void gemm_pack_b(size_t kc, size_t nc, const double *B, size_t rsb, size_t csb,
+                 size_t nr, double *Bp) {
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        const size_t cols = MIN(nr, nc - jr);
+        if (csb == 1) {
+            for (size_t k = 0; k < kc; k++) {
+                const double *b = &B[k * rsb + jr];
+                for (size_t j = 0; j < cols; j++)
+                    Bp[k * nr + j] = b[j];
+            }
+        } else {
+            for (size_t j = 0; j < cols; j++) {
+                const double *b = &B[(jr + j) * csb];
+                for (size_t k = 0; k < kc; k++)
+                    Bp[k * nr + j] = b[k * rsb];
+            }
+        }
+        for (size_t k = 0; k < kc; k++)
+            for (size_t j = cols; j < nr; j++)
+                Bp[k * nr + j] = 0.0;
+        Bp += nr * kc;
+    }
+}
+
+// Merges a tile computed in a scratch buffer into C
+static void merge_tile(size_t mr, size_t nr, const double *tile, size_t ldt,
+                       double beta, double *C, size_t rsc, size_t csc) {
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) {
+            double *c = &C[i * rsc + j * csc];
+            if (beta == 0.0)
+                *c = tile[i * ldt + j];
+            else
+                *c = tile[i * ldt + j] + beta * *c;
+        }
+    }
+}
+
+// Applies the epilogue to a rows x cols tile of C that begins at element (i0, j0)
+static void epilogue_tile(const gemm_epilogue *ep, size_t i0, size_t j0, size_t rows, size_t cols,
+                          double *C, size_t rsc, size_t csc) {
+    for (size_t i = 0; i < rows; i++) {
+        const double row_bias = ep->row_bias ? ep->row_bias[i0 + i] : 0.0;
+        double sum = 0.0;
+        for (size_t j = 0; j < cols; j++) {
+            double c = C[i * rsc + j * csc] + row_bias;
+            if (ep->col_bias)
+                c += ep->col_bias[j0 + j];
+            if (ep->clamp)
+                c = c < ep->lo ? ep->lo : c > ep->hi ? ep->hi : c;
+            C[i * rsc + j * csc] = c;
+            sum += c;
+        }
+        if (ep->row_sums)
+            ep->row_sums[i0 + i] += sum;
+    }
+}
+
+// Multiplies the packed block of A by the packed panel of B using the micro-kernel;
+// ep is the epilogue to apply to each tile once it is complete, or NULL, and
+// (i0, j0) the position of the block in the whole C
+void gemm_macro_kernel(const gemm_kernel *kern, size_t mc, size_t nc, size_t kc,
+                       double alpha, const double *Ap, const double *Bp,
+                       double beta, double *C, size_t rsc, size_t csc,
+                       const gemm_epilogue *ep, size_t i0, size_t j0) {
+    double tile[GEMM_MAX_MR * GEMM_MAX_NR];
+
+    for (size_t jr = 0; jr < nc; jr += kern->nr) {
+        const size_t nr = MIN(kern->nr, nc - jr);
+        for (size_t ir = 0; ir < mc; ir += kern->mr) {
+            const size_t mr = MIN(kern->mr, mc - ir);
+            const double *a = &Ap[ir * kc];
+            const double *b = &Bp[jr * kc];
+            double *c = &C[ir * rsc + jr * csc];
+            if (mr == kern->mr && nr == kern->nr && csc == 1) {
+                kern->fn(kc, a, b, alpha, c, rsc, beta);
+            } else {
+                kern->fn(kc, a, b, alpha, tile, kern->nr, 0.0);
+                merge_tile(mr, nr, tile, kern->nr, beta, c, rsc, csc);
+            }
+            // The tile has just been written, so it is still in the L1 cache
+            if (ep)
+                epilogue_tile(ep, i0 + ir, j0 + jr, mr, nr, c, rsc, csc);
+        }
+    }
+}
+
+// Computes the product without packing buffers, used when they cannot be allocated
+static void gemm_unpacked(size_t m, size_t n, size_t p, double alpha,
+                          const double *A, size_t rsa, size_t csa,
+                          const double *B, size_t rsb, size_t csb,
+                          double beta, double *C, size_t rsc, size_t csc) {
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (size_t k = 0; k < p; k++)
+                sum += A[i * rsa + k * csa] * B[k * rsb + j * csb];
+            double *c = &C[i * rsc + j * csc];
+            *c = beta == 0.0 ? alpha * sum : alpha * sum + beta * *c;
+        }
+    }
+}
+
+// Panel of a prepared B that the driver packs at column jc and row pc
+static double *prepared_panel(const gemm_prepared *prep, size_t jc, size_t pc) {
+    const size_t nc = MIN(prep->kern->nc, prep->n - jc);
+    return &prep->panels[prep->p * jc + pc * ROUND_UP(nc, prep->kern->nr)];
+}
+
+// Engine shared by gemm_strided(), gemm_fused() and gemm_prepared_mul():
+// C = alpha * A * B + beta * C followed by the epilogue, if any. The panels of
+// B are packed on the fly, or taken from prep if it is not NULL
+static void gemm_driver(size_t m, size_t n, size_t p, double alpha,
+                        const double *A, size_t rsa, size_t csa,
+                        const double *B, size_t rsb, size_t csb,
+                        double beta, double *C, size_t rsc, size_t csc,
+                        const gemm_epilogue *ep, const gemm_prepared *prep) {
+    const gemm_kernel *kern = prep ? prep->kern : gemm_kernel_get();
+
+    if (ep && ep->row_sums)
+        for (size_t i = 0; i < m; i++)
+            ep->row_sums[i] = 0.0;
+
+    // Nothing to accumulate: only the scaling of C remains
+    if (p == 0 || alpha == 0.0) {
+        for (size_t i = 0; i < m; i++) {
+            for (size_t j = 0; j < n; j++) {
+                double *c = &C[i * rsc + j * csc];
+                *c = beta == 0.0 ? 0.0 : beta * *c;
+            }
+        }
+        if (ep)
+            epilogue_tile(ep, 0, 0, m, n, C, rsc, csc);
+        return;
+    }
+
+    // Packing buffers, sized for the largest block of this problem
+    const size_t mc_max = MIN(kern->mc, ROUND_UP(m, kern->mr));
+    const size_t nc_max = MIN(kern->nc, ROUND_UP(n, kern->nr));
+    const size_t kc_max = MIN(kern->kc, p);
+    double *Ap = (double *)new_buffer(mc_max * kc_max * sizeof(double));
+    double *Bp = prep ? NULL : (double *)new_buffer(kc_max * nc_max * sizeof(double));
+    if (!Ap || (!prep && !Bp)) {
+        // Fall back to an unpacked computation if the buffers cannot be allocated
+        delete_buffer(Ap);
+        delete_buffer(Bp);
+        gemm_unpacked(m, n, p, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+        if (ep)
+            epilogue_tile(ep, 0, 0, m, n, C, rsc, csc);
+        return;
+    }
+
+    for (size_t jc = 0; jc < n; jc += kern->nc) {
+        const size_t nc = MIN(kern->nc, n - jc);
+        for (size_t pc = 0; pc < p; pc += kern->kc) {
+            const size_t kc = MIN(kern->kc, p - pc);
+            // Only the first panel scales C; the following ones accumulate, and
+            // the last one completes the tiles
+            const double beta_pc = pc == 0 ? beta : 1.0;
+            const gemm_epilogue *ep_pc = pc + kc == p ? ep : NULL;
+            const double *panel = Bp;
+            if (prep)
+                panel = prepared_panel(prep, jc, pc);
+            else
+                gemm_pack_b(kc, nc, &B[pc * rsb + jc * csb], rsb, csb, kern->nr, Bp);
+            for (size_t ic = 0; ic < m; ic += kern->mc) {
+                const size_t mc = MIN(kern->mc, m - ic);
+                gemm_pack_a(mc, kc, &A[ic * rsa + pc * csa], rsa, csa, kern->mr, Ap);
+                gemm_macro_kernel(kern, mc, nc, kc, alpha, Ap, panel, beta_pc,
+                                  &C[ic * rsc + jc * csc], rsc, csc, ep_pc, ic, jc);
+            }
+        }
+    }
+
+    delete_buffer(Ap);
+    delete_buffer(Bp);
+}
+
+// C (m x n) = alpha * A (m x p) * B (p x n) + beta * C for operands with any strides
+void gemm_strided(size_t m, size_t n, size_t p, double alpha,
+                  const double *A, size_t rsa, size_t csa,
+                  const double *B, size_t rsb, size_t csb,
+                  double beta, double *C, size_t rsc, size_t csc) {
+    if (m == 0 || n == 0)
+        return;
+
+    // A column-major C is computed as the row-major C^T = B^T * A^T, so that the
+    // micro-kernel can still write the rows of its tiles contiguously
+    if (csc != 1 && rsc == 1) {
+        gemm_strided(n, m, p, alpha, B, csb, rsb, A, csa, rsa, beta, C, csc, rsc);
+        return;
+    }
+    gemm_driver(m, n, p, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc, NULL, NULL);
+}
+
+// C (m x n) = epilogue(alpha * A (m x p) * B (p x n) + beta * C) over the
+// linearized matrix data
+void gemm_fused(size_t m, size_t n, size_t p, double alpha,
+                const double *A, size_t lda,
+                const double *B, size_t ldb,
+                double beta, double *C, size_t ldc,
+                const gemm_epilogue *ep) {
+    if (m == 0 || n == 0)
+        return;
+    gemm_driver(m, n, p, alpha, A, lda, 1, B, ldb, 1, beta, C, ldc, 1, ep, NULL);
+}
+
+// C (m x n) = A (m x p) * B (p x n) + beta * C over the linearized matrix data
+void gemm_packed(size_t m, size_t n, size_t p,
+                 const double *A, size_t lda,
+                 const double *B, size_t ldb,
+                 double beta, double *C, size_t ldc) {
+    gemm_strided(m, n, p, 1.0, A, lda, 1, B, ldb, 1, beta, C, ldc, 1);
+}
+
+// C = alpha * op(A) * op(B) + beta * C, where op(X) is X or its transpose and
+// the matrices are stored in the selected layout
+void gemm(gemm_layout layout, gemm_trans transA, gemm_trans transB,
+          size_t m, size_t n, size_t k, double alpha,
+          const double *A, size_t lda,
+          const double *B, size_t ldb,
+          double beta, double *C, size_t ldc) {
+    // In row-major order a transposed operand swaps its strides, and in
+    // column-major order the non-transposed ones do
+    const int row_major = layout == GEMM_ROW_MAJOR;
+    const int swapA = (transA == GEMM_TRANS) == row_major;
+    const int swapB = (transB == GEMM_TRANS) == row_major;
+    gemm_strided(m, n, k, alpha,
+                 A, swapA ? 1 : lda, swapA ? lda : 1,
+                 B, swapB ? 1 : ldb, swapB ? ldb : 1,
+                 beta, C, row_major ? ldc : 1, row_major ? 1 : ldc);
+}
+
+// Packs every panel of B at the position given by prepared_panel()
+static void pack_prepared(gemm_prepared *prep) {
+    const gemm_kernel *kern = prep->kern;
+    for (size_t jc = 0; jc < prep->n; jc += kern->nc) {
+        const size_t nc = MIN(kern->nc, prep->n - jc);
+        for (size_t pc = 0; pc < prep->p; pc += kern->kc) {
+            const size_t kc = MIN(kern->kc, prep->p - pc);
+            gemm_pack_b(kc, nc, &prep->B[pc * prep->ldb + jc], prep->ldb, 1, kern->nr,
+                        prepared_panel(prep, jc, pc));
+        }
+    }
+    prep->valid = 1;
+    prep->packs++;
+}
+
+gemm_prepared *gemm_prepare(size_t p, size_t n, const double *B, size_t ldb) {
+    gemm_prepared *prep = (gemm_prepared *)calloc(1, sizeof(gemm_prepared));
+    if (!prep)
+        return NULL;
+    prep->p = p;
+    prep->n = n;
+    prep->B = B;
+    prep->ldb = ldb;
+    prep->kern = gemm_kernel_get();
+
+    // An empty B has no panels
+    const size_t size = p * ROUND_UP(n, prep->kern->nr);
+    if (size > 0) {
+        prep->panels = (double *)new_buffer(size * sizeof(double));
+        if (!prep->panels) {
+            free(prep);
+            return NULL;
+        }
+    }
+    pack_prepared(prep);
+    return prep;
+}
+
+void gemm_prepared_delete(gemm_prepared *prep) {
+    if (prep) {
+        delete_buffer(prep->panels);
+        free(prep);
+    }
+}
+
+void gemm_prepared_invalidate(gemm_prepared *prep) {
+    prep->valid = 0;
+}
+
+void gemm_prepared_mul(size_t m, double alpha, const double *A, size_t lda,
+                       gemm_prepared *prep, double beta, double *C, size_t ldc) {
+    if (m == 0 || prep->n == 0)
+        return;
+    if (!prep->valid)
+        pack_prepared(prep);
+    gemm_driver(m, prep->n, prep->p, alpha, A, lda, 1, prep->B, prep->ldb, 1,
+                beta, C, ldc, 1, NULL, prep);
+}
+
+// C (m x n) = A (m x p) * B (p x n)
+void matmul_packed(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    gemm_packed(m, n, p, A[0], matrix_ld(A, m, p), B[0], matrix_ld(B, p, n),
+                0.0, C[0], matrix_ld(C, m, n));
+}
+
+// Row sums of the last result of matmul_fused() and its clamping bound
+static double *fused_row_sums = NULL;
+static size_t fused_capacity = 0;
+static size_t fused_rows = 0;
+static size_t fused_clamp = 0;
+static int fused_ok = 1;
+
+void matmul_fused_set_clamp(size_t clamp) {
+    fused_clamp = clamp;
+}
+
+// C (m x n) = A (m x p) * B (p x n), summing the rows of C in the epilogue
+void matmul_fused(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    if (m > fused_capacity) {
+        delete_buffer(fused_row_sums);
+        fused_row_sums = (double *)new_buffer(m * sizeof(double));
+        fused_capacity = fused_row_sums ? m : 0;
+    }
+    fused_ok = m <= fused_capacity;
+    gemm_epilogue ep = {NULL, NULL, fused_clamp > 0, 0.0, (double)fused_clamp,
+                        fused_ok ? fused_row_sums : NULL};
+    gemm_fused(m, n, p, 1.0, A[0], matrix_ld(A, m, p), B[0], matrix_ld(B, p, n),
+               0.0, C[0], matrix_ld(C, m, n), &ep);
+    fused_rows = fused_ok ? m : 0;
+}
+
+double matmul_fused_checksum(void) {
+    if (!fused_ok)
+        return NAN;
+    double checksum = 0.0;
+    for (size_t i = 0; i < fused_rows; i++)
+        checksum += fused_row_sums[i];
+    return checksum;
+}
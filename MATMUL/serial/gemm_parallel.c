@@ -0,0 +1,97 @@
+#include <gemm.h>
+#include <matrix.h>
+#include <gemm_kernel.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Column tiles are multiples of a cache line (8 doubles) to limit false sharing in C
+#define TILE_COL_ALIGN 8
+
+// Splits the threads into a rows x cols grid whose tiles of an m x n matrix are
+// as square as possible, which minimizes the data of A and B read by each thread
+void gemm_grid(int nthreads, size_t m, size_t n, int *rows, int *cols) {
+    double best_ratio = 0.0;
+    *rows = nthreads;
+    *cols = 1;
+    for (int r = 1; r <= nthreads; r++) {
+        if (nthreads % r)
+            continue;
+        const int c = nthreads / r;
+        const double tile_m = (double)m / r, tile_n = (double)n / c;
+        const double ratio = tile_m > tile_n ? tile_n / tile_m : tile_m / tile_n;
+        if (ratio > best_ratio) {
+            best_ratio = ratio;
+            *rows = r;
+            *cols = c;
+        }
+    }
+}
+
+// Computes the [begin, end) range of the part idx when splitting len elements
+// into the selected number of parts, keeping the boundaries aligned
+static void tile_range(size_t len, int parts, int idx, size_t align, size_t *begin, size_t *end) {
+    const size_t units = (len + align - 1) / align;
+    *begin = MIN(units * idx / parts * align, len);
+    *end = MIN(units * (idx + 1) / parts * align, len);
+}
+
+// Computes the tile of an m x n matrix that belongs to the calling thread
+static void thread_tile(size_t m, size_t n, size_t *i0, size_t *i1, size_t *j0, size_t *j1) {
+    int rows, cols;
+#ifdef _OPENMP
+    const int nthreads = omp_get_num_threads(), tid = omp_get_thread_num();
+#else
+    const int nthreads = 1, tid = 0;
+#endif
+    gemm_grid(nthreads, m, n, &rows, &cols);
+    tile_range(m, rows, tid / cols, gemm_kernel_get()->mr, i0, i1);
+    tile_range(n, cols, tid % cols, TILE_COL_ALIGN, j0, j1);
+}
+
+// C (m x n) = A (m x p) * B (p x n) + beta * C, each thread computing a tile of C
+void gemm_parallel(size_t m, size_t n, size_t p,
+                   const double *A, size_t lda,
+                   const double *B, size_t ldb,
+                   double beta, double *C, size_t ldc) {
+    // Selects the kernel before entering the parallel region
+    gemm_kernel_get();
+
+#pragma omp parallel
+    {
+        size_t i0, i1, j0, j1;
+        thread_tile(m, n, &i0, &i1, &j0, &j1);
+        if (i0 < i1 && j0 < j1)
+            gemm_packed(i1 - i0, j1 - j0, p, &A[i0 * lda], lda, &B[j0], ldb,
+                        beta, &C[i0 * ldc + j0], ldc);
+    }
+}
+
+// Zeroes an m x n matrix with the same thread-to-tile mapping used by
+// gemm_parallel(), so that each page is allocated in the NUMA node of the
+// thread that works on it (first-touch policy)
+void gemm_first_touch(size_t m, size_t n, double *C, size_t ldc) {
+#pragma omp parallel
+    {
+        size_t i0, i1, j0, j1;
+        thread_tile(m, n, &i0, &i1, &j0, &j1);
+        for (size_t i = i0; i < i1; i++)
+            for (size_t j = j0; j < j1; j++)
+                C[i * ldc + j] = 0.0;
+    }
+}
+
+// C (m x n) = A (m x p) * B (p x n)
+void matmul_parallel(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    gemm_parallel(m, n, p, A[0], matrix_ld(A, m, p), B[0], matrix_ld(B, p, n),
+                  0.0, C[0], matrix_ld(C, m, n));
+}
+
+// Places the pages of a matrix created with new_matrix() before initializing it
+void first_touch_matrix(double **mat, size_t rows, size_t cols) {
+    if (mat)
+        gemm_first_touch(rows, cols, mat[0], matrix_ld(mat, rows, cols));
+}
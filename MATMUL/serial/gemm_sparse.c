@@ -0,0 +1,114 @@
+#include <string.h>
+#include <gemm.h>
+#include <gemm_kernel.h>
+#include <matrix.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define ROUND_UP(x, m) (((x) + (m) - 1) / (m) * (m))
+
+// Index of the lowest set bit of a nonzero word
+static unsigned lowest_bit(uint64_t word) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(word);
+#else
+    unsigned bit = 0;
+    for (; !(word & 1); word >>= 1)
+        bit++;
+    return bit;
+#endif
+}
+
+// Returns the first tile column from bj on that holds a nonzero tile in tile
+// row bi, or tile_cols if there is none
+static size_t next_tile(const BlockSparseMatrix *mat, size_t bi, size_t bj) {
+    const uint64_t *row = &mat->bitmap[bi * mat->words];
+    for (size_t w = bj / 64; w < mat->words; w++) {
+        uint64_t word = row[w];
+        if (w == bj / 64)
+            word &= ~(uint64_t)0 << (bj % 64);
+        if (word)
+            return w * 64 + lowest_bit(word);
+    }
+    return mat->tile_cols;
+}
+
+/*   C = A * B over the pairs of nonzero tiles only
+
+       C(bi, bj) += A(bi, bk) * B(bk, bj) for A(bi, bk) != 0 and B(bk, bj) != 0
+
+     Each nonzero tile of A is packed once and multiplied by all the nonzero
+     tiles of the matching tile row of B, so the work is proportional to the
+     number of such pairs rather than to the dimensions. The tiles of B, which
+     are reused by every tile row of A, are all packed beforehand. Both packings
+     and the tile products are those of the dense packed engine.
+*/
+int gemm_block_sparse(const BlockSparseMatrix *A, const BlockSparseMatrix *B,
+                      double *C, size_t ldc) {
+    if (A->cols != B->rows)
+        return 0;
+
+    const size_t bs = BLOCK_SPARSE_TILE;
+    const size_t m = A->rows, n = B->cols, p = A->cols;
+    for (size_t i = 0; i < m; i++)
+        memset(&C[i * ldc], 0, n * sizeof(double));
+
+    const size_t count_b = B->row_start[B->tile_rows];
+    if (A->row_start[A->tile_rows] == 0 || count_b == 0)
+        return 1;
+
+    const gemm_kernel *kern = gemm_kernel_get();
+    const size_t panel_a = ROUND_UP(bs, kern->mr) * bs;
+    const size_t panel_b = ROUND_UP(bs, kern->nr) * bs;
+    double *Ap = (double *)new_buffer(panel_a * sizeof(double));
+    double *Bp = (double *)new_buffer(count_b * panel_b * sizeof(double));
+    if (!Ap || !Bp) {
+        delete_buffer(Ap);
+        delete_buffer(Bp);
+        return 0;
+    }
+
+    for (size_t bk = 0; bk < B->tile_rows; bk++) {
+        const size_t kc = MIN(bs, p - bk * bs);
+        size_t t = B->row_start[bk];
+        for (size_t bj = next_tile(B, bk, 0); bj < B->tile_cols; bj = next_tile(B, bk, bj + 1)) {
+            const size_t nc = MIN(bs, n - bj * bs);
+            gemm_pack_b(kc, nc, &B->tiles[t * bs * bs], bs, 1, kern->nr, &Bp[t * panel_b]);
+            t++;
+        }
+    }
+
+    const double *a = A->tiles;
+    for (size_t bi = 0; bi < A->tile_rows; bi++) {
+        const size_t i0 = bi * bs, mc = MIN(bs, m - i0);
+        for (size_t bk = next_tile(A, bi, 0); bk < A->tile_cols; bk = next_tile(A, bi, bk + 1)) {
+            const size_t kc = MIN(bs, p - bk * bs);
+            gemm_pack_a(mc, kc, a, bs, 1, kern->mr, Ap);
+            a += bs * bs;
+
+            size_t t = B->row_start[bk];
+            for (size_t bj = next_tile(B, bk, 0); bj < B->tile_cols;
+                 bj = next_tile(B, bk, bj + 1)) {
+                const size_t j0 = bj * bs, nc = MIN(bs, n - j0);
+                gemm_macro_kernel(kern, mc, nc, kc, 1.0, Ap, &Bp[t * panel_b],
+                                  1.0, &C[i0 * ldc + j0], ldc, 1, NULL, 0, 0);
+                t++;
+            }
+        }
+    }
+
+    delete_buffer(Ap);
+    delete_buffer(Bp);
+    return 1;
+}
+
+// The operands are converted to the block-sparse format, which is only worth it
+// when they have enough zero tiles (see the sparse benchmark)
+void matmul_block_sparse(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    BlockSparseMatrix *As = new_block_sparse(A, m, p);
+    BlockSparseMatrix *Bs = new_block_sparse(B, p, n);
+    // Fall back to the dense engine if there is no memory for the copies
+    if (!As || !Bs || !gemm_block_sparse(As, Bs, C[0], matrix_ld(C, m, n)))
+        matmul_packed(m, n, p, A, B, C);
+    delete_block_sparse(As);
+    delete_block_sparse(Bs);
+}
@@ -0,0 +1,152 @@
+#include <gemm.h>
+#include <matrix.h>
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Default size below which the recursion falls back to the packed kernel
+#define STRASSEN_DEFAULT_CUTOVER 512
+
+static size_t strassen_cutover = STRASSEN_DEFAULT_CUTOVER;
+
+void strassen_set_cutover(size_t cutover) {
+    strassen_cutover = cutover > 0 ? cutover : STRASSEN_DEFAULT_CUTOVER;
+}
+
+static int use_recursion(size_t m, size_t n, size_t p, size_t cutover) {
+    return m > cutover && n > cutover && p > cutover;
+}
+
+// Returns the number of doubles of workspace needed by gemm_strassen(): each
+// level needs the temporaries X (m/2 x max(p/2, n/2)) and Y (p/2 x n/2)
+size_t strassen_workspace_size(size_t m, size_t n, size_t p, size_t cutover) {
+    size_t size = 0;
+    while (use_recursion(m, n, p, cutover)) {
+        m /= 2;
+        n /= 2;
+        p /= 2;
+        size += m * MAX(p, n) + p * n;
+    }
+    return size;
+}
+
+// Z = X + Y
+static void add(size_t m, size_t n, const double *X, size_t ldx, const double *Y, size_t ldy,
+                double *Z, size_t ldz) {
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < n; j++)
+            Z[i * ldz + j] = X[i * ldx + j] + Y[i * ldy + j];
+}
+
+// Z = X - Y
+static void sub(size_t m, size_t n, const double *X, size_t ldx, const double *Y, size_t ldy,
+                double *Z, size_t ldz) {
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < n; j++)
+            Z[i * ldz + j] = X[i * ldx + j] - Y[i * ldy + j];
+}
+
+/*   Strassen-Winograd recursion (7 products and 15 additions per level)
+
+     The schedule of Douglas et al. (1994) builds the quadrants of C in place,
+     so each level only needs two temporaries, X and Y, taken from the
+     workspace; the deeper levels use the workspace that follows them.
+*/
+static void strassen(size_t m, size_t n, size_t p,
+                     const double *A, size_t lda,
+                     const double *B, size_t ldb,
+                     double *C, size_t ldc,
+                     double *ws, size_t cutover) {
+    if (!use_recursion(m, n, p, cutover)) {
+        gemm_packed(m, n, p, A, lda, B, ldb, 0.0, C, ldc);
+        return;
+    }
+
+    // Quadrants of the even-sized leading part of each matrix
+    const size_t mh = m / 2, nh = n / 2, ph = p / 2;
+    const double *A11 = A, *A12 = A + ph, *A21 = A + mh * lda, *A22 = A21 + ph;
+    const double *B11 = B, *B12 = B + nh, *B21 = B + ph * ldb, *B22 = B21 + nh;
+    double *C11 = C, *C12 = C + nh, *C21 = C + mh * ldc, *C22 = C21 + nh;
+
+    double *X = ws;
+    double *Y = X + mh * MAX(ph, nh);
+    double *next = Y + ph * nh;
+    const size_t ldx = ph, ldy = nh, ldp = nh;
+
+    // P7 = (A11 - A21) * (B22 - B12) -> C21
+    sub(mh, ph, A11, lda, A21, lda, X, ldx);
+    sub(ph, nh, B22, ldb, B12, ldb, Y, ldy);
+    strassen(mh, nh, ph, X, ldx, Y, ldy, C21, ldc, next, cutover);
+
+    // P5 = (A21 + A22) * (B12 - B11) -> C22
+    add(mh, ph, A21, lda, A22, lda, X, ldx);
+    sub(ph, nh, B12, ldb, B11, ldb, Y, ldy);
+    strassen(mh, nh, ph, X, ldx, Y, ldy, C22, ldc, next, cutover);
+
+    // P6 = (A21 + A22 - A11) * (B22 - B12 + B11) -> C12
+    sub(mh, ph, X, ldx, A11, lda, X, ldx);
+    sub(ph, nh, B22, ldb, Y, ldy, Y, ldy);
+    strassen(mh, nh, ph, X, ldx, Y, ldy, C12, ldc, next, cutover);
+
+    // P3 = (A12 - A21 - A22 + A11) * B22 -> C11
+    sub(mh, ph, A12, lda, X, ldx, X, ldx);
+    strassen(mh, nh, ph, X, ldx, B22, ldb, C11, ldc, next, cutover);
+
+    // P1 = A11 * B11 -> X
+    strassen(mh, nh, ph, A11, lda, B11, ldb, X, ldp, next, cutover);
+
+    add(mh, nh, X, ldp, C12, ldc, C12, ldc);   // U2 = P1 + P6
+    add(mh, nh, C12, ldc, C21, ldc, C21, ldc); // U3 = U2 + P7
+    add(mh, nh, C12, ldc, C22, ldc, C12, ldc); // U4 = U2 + P5
+    add(mh, nh, C21, ldc, C22, ldc, C22, ldc); // C22 = U3 + P5
+    add(mh, nh, C12, ldc, C11, ldc, C12, ldc); // C12 = U4 + P3
+
+    // P4 = A22 * (B22 - B12 + B11 - B21) -> C11
+    sub(ph, nh, Y, ldy, B21, ldb, Y, ldy);
+    strassen(mh, nh, ph, A22, lda, Y, ldy, C11, ldc, next, cutover);
+    sub(mh, nh, C21, ldc, C11, ldc, C21, ldc); // C21 = U3 - P4
+
+    // P2 = A12 * B21 -> C11
+    strassen(mh, nh, ph, A12, lda, B21, ldb, C11, ldc, next, cutover);
+    add(mh, nh, X, ldp, C11, ldc, C11, ldc);   // C11 = P1 + P2
+
+    // Odd dimensions are handled by peeling the last row, column or rank-1 update
+    const size_t me = 2 * mh, ne = 2 * nh;
+    if (p & 1)
+        gemm_packed(me, ne, 1, &A[p - 1], lda, &B[(p - 1) * ldb], ldb, 1.0, C, ldc);
+    if (n & 1)
+        gemm_packed(m, 1, p, A, lda, &B[n - 1], ldb, 0.0, &C[n - 1], ldc);
+    if (m & 1)
+        gemm_packed(1, ne, p, &A[(m - 1) * lda], lda, B, ldb, 0.0, &C[(m - 1) * ldc], ldc);
+}
+
+// C (m x n) = A (m x p) * B (p x n) using Strassen-Winograd down to the cutover
+// size; the workspace must hold strassen_workspace_size() doubles, or be NULL
+// to allocate it internally. Returns zero if the workspace cannot be allocated.
+int gemm_strassen(size_t m, size_t n, size_t p,
+                  const double *A, size_t lda,
+                  const double *B, size_t ldb,
+                  double *C, size_t ldc,
+                  double *workspace, size_t cutover) {
+    const size_t ws_size = strassen_workspace_size(m, n, p, cutover);
+    double *ws = workspace;
+    if (!ws && ws_size > 0) {
+        ws = (double *)new_buffer(ws_size * sizeof(double));
+        if (!ws)
+            return 0;
+    }
+
+    strassen(m, n, p, A, lda, B, ldb, C, ldc, ws, cutover);
+
+    if (ws != workspace)
+        delete_buffer(ws);
+    return 1;
+}
+
+// C (m x n) = A (m x p) * B (p x n)
+void matmul_strassen(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
+    const size_t lda = matrix_ld(A, m, p), ldb = matrix_ld(B, p, n), ldc = matrix_ld(C, m, n);
+
+    // Without memory for the temporaries, the classic algorithm is used instead
+    if (!gemm_strassen(m, n, p, A[0], lda, B[0], ldb, C[0], ldc, NULL, strassen_cutover))
+        gemm_packed(m, n, p, A[0], lda, B[0], ldb, 0.0, C[0], ldc);
+}
@@ -0,0 +1,87 @@
+#include <gemm.h>
+#include <matrix.h>
+
+// Diagonal blocks of at most this size are computed whole in a scratch tile
+#define SYRK_LEAF 64
+
+// Side of the tiles of the mirroring copy
+#define MIRROR_TILE 32
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Diagonal block: the whole n x n product is computed in a scratch tile and
+// only the selected triangle is merged into C
+static void syrk_leaf(gemm_uplo uplo, size_t n, size_t k, double alpha,
+                      const double *A, size_t lda, double beta, double *C, size_t ldc) {
+    double tile[SYRK_LEAF * SYRK_LEAF];
+    gemm_strided(n, n, k, alpha, A, lda, 1, A, 1, lda, 0.0, tile, SYRK_LEAF, 1);
+
+    for (size_t i = 0; i < n; i++) {
+        const size_t j0 = uplo == GEMM_LOWER ? 0 : i;
+        const size_t j1 = uplo == GEMM_LOWER ? i + 1 : n;
+        for (size_t j = j0; j < j1; j++) {
+            double *c = &C[i * ldc + j];
+            *c = beta == 0.0 ? tile[i * SYRK_LEAF + j] : tile[i * SYRK_LEAF + j] + beta * *c;
+        }
+    }
+}
+
+/*   Recursive splitting of the triangle
+
+       | C11     |   | A1 |                  C11 = A1 A1^T (recursion)
+       | C21 C22 | = | A2 | | A1^T A2^T | => C21 = A2 A1^T (packed GEMM)
+                                             C22 = A2 A2^T (recursion)
+
+     The off-diagonal blocks, which hold almost all the flops, are computed by
+     the packed SIMD engine, reading A^T in place through its strides. Only the
+     diagonal leaves compute a few elements outside the triangle.
+*/
+static void syrk_recursive(gemm_uplo uplo, size_t n, size_t k, double alpha,
+                           const double *A, size_t lda, double beta, double *C, size_t ldc) {
+    if (n <= SYRK_LEAF) {
+        syrk_leaf(uplo, n, k, alpha, A, lda, beta, C, ldc);
+        return;
+    }
+
+    const size_t h = n / 2;
+    const double *A2 = &A[h * lda];
+    syrk_recursive(uplo, h, k, alpha, A, lda, beta, C, ldc);
+    if (uplo == GEMM_LOWER)
+        gemm_strided(n - h, h, k, alpha, A2, lda, 1, A, 1, lda, beta, &C[h * ldc], ldc, 1);
+    else
+        gemm_strided(h, n - h, k, alpha, A, lda, 1, A2, 1, lda, beta, &C[h], ldc, 1);
+    syrk_recursive(uplo, n - h, k, alpha, A2, lda, beta, &C[h * ldc + h], ldc);
+}
+
+// Copies the selected triangle of C over the other one, tile by tile so that
+// both the rows read and the columns written stay in the cache
+static void mirror_triangle(gemm_uplo uplo, size_t n, double *C, size_t ldc) {
+    for (size_t i0 = 0; i0 < n; i0 += MIRROR_TILE) {
+        for (size_t j0 = 0; j0 <= i0; j0 += MIRROR_TILE) {
+            const size_t i1 = MIN(i0 + MIRROR_TILE, n), j1 = MIN(j0 + MIRROR_TILE, n);
+            for (size_t i = i0; i < i1; i++) {
+                for (size_t j = j0; j < MIN(j1, i); j++) {
+                    if (uplo == GEMM_LOWER)
+                        C[j * ldc + i] = C[i * ldc + j];
+                    else
+                        C[i * ldc + j] = C[j * ldc + i];
+                }
+            }
+        }
+    }
+}
+
+// C (n x n) = alpha * A (n x k) * A^T + beta * C over the selected triangle
+void syrk(gemm_uplo uplo, size_t n, size_t k, double alpha,
+          const double *A, size_t lda, double beta, double *C, size_t ldc, int mirror) {
+    if (n == 0)
+        return;
+    syrk_recursive(uplo, n, k, alpha, A, lda, beta, C, ldc);
+    if (mirror)
+        mirror_triangle(uplo, n, C, ldc);
+}
+
+// C (n x n) = A (n x k) * A^T, the whole symmetric matrix
+void matmul_syrk(size_t n, size_t k, double **A, double **C) {
+    syrk(GEMM_LOWER, n, k, 1.0, A[0], matrix_ld(A, n, k), 0.0, C[0], matrix_ld(C, n, n), 1);
+}
@@ -0,0 +1,149 @@
+#pragma once
+#ifndef _GEMM_H_
+#define _GEMM_H_
+
+#include <stdlib.h>
+#include <matrix.h>
+
+/*   Optimized matrix multiplication engines
+
+     All the engines compute C (m x n) = A (m x p) * B (p x n) and accept the
+     same arguments as matmul() so that they can be compared against it. The
+     gemm_* variants work directly on the linearized data of each matrix and
+     take the leading dimension (distance between rows, in doubles) of each
+     operand.
+*/
+
+// Cache-blocked and register-tiled version of matmul()
+void matmul_blocked(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+void gemm_blocked(size_t m, size_t n, size_t p,
+                  const double *A, size_t lda,
+                  const double *B, size_t ldb,
+                  double *C, size_t ldc);
+
+// Packed-panel version of matmul() with SIMD micro-kernels selected at runtime
+void matmul_packed(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+// C = A * B + beta * C; C is not read when beta is zero
+void gemm_packed(size_t m, size_t n, size_t p,
+                 const double *A, size_t lda,
+                 const double *B, size_t ldb,
+                 double beta, double *C, size_t ldc);
+
+// Storage order of the operands of gemm() and whether each input is transposed
+typedef enum { GEMM_ROW_MAJOR, GEMM_COL_MAJOR } gemm_layout;
+typedef enum { GEMM_NO_TRANS, GEMM_TRANS } gemm_trans;
+
+// C (m x n) = alpha * op(A) (m x k) * op(B) (k x n) + beta * C, where op(X) is
+// X or its transpose; C is not read when beta is zero
+void gemm(gemm_layout layout, gemm_trans transA, gemm_trans transB,
+          size_t m, size_t n, size_t k, double alpha,
+          const double *A, size_t lda,
+          const double *B, size_t ldb,
+          double beta, double *C, size_t ldc);
+
+// Same as gemm(), addressing element (i, j) of each operand X as
+// X[i * rsx + j * csx] through its row and column strides
+void gemm_strided(size_t m, size_t n, size_t p, double alpha,
+                  const double *A, size_t rsa, size_t csa,
+                  const double *B, size_t rsb, size_t csb,
+                  double beta, double *C, size_t rsc, size_t csc);
+
+/*   Epilogue of gemm_fused(), applied to each tile of C right after its last
+     update, while the tile is still in the L1 cache, instead of making extra
+     passes over the whole C. Each element becomes
+
+       c = clamp(c + row_bias[i] + col_bias[j], lo, hi)
+
+     and row_sums receives the sum of each row of the final C. Unused fields
+     are NULL (or zero for clamp); a ReLU is a clamp to [0, INFINITY].
+*/
+typedef struct gemm_epilogue {
+    const double *row_bias; // m values, or NULL
+    const double *col_bias; // n values, or NULL
+    int clamp;              // Non-zero to clamp the elements to [lo, hi]
+    double lo, hi;
+    double *row_sums;       // m values (overwritten), or NULL
+} gemm_epilogue;
+
+// C (m x n) = epilogue(alpha * A (m x p) * B (p x n) + beta * C); C is not
+// read when beta is zero
+void gemm_fused(size_t m, size_t n, size_t p, double alpha,
+                const double *A, size_t lda,
+                const double *B, size_t ldb,
+                double beta, double *C, size_t ldc,
+                const gemm_epilogue *ep);
+
+// Version of matmul() that computes the checksum of C within the epilogue
+// (see matmul_fused_checksum()), optionally clamping C to [0, clamp]
+void matmul_fused(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+void matmul_fused_set_clamp(size_t clamp);
+
+// Checksum of the last result of matmul_fused(), from its row sums; NaN if
+// they could not be allocated
+double matmul_fused_checksum(void);
+
+// Triangle of a symmetric matrix (including the diagonal)
+typedef enum { GEMM_LOWER, GEMM_UPPER } gemm_uplo;
+
+// Symmetric rank-k update: C (n x n) = alpha * A (n x k) * A^T + beta * C,
+// computing only the selected triangle of C with half the flops of gemm().
+// The other triangle is not accessed unless mirror is non-zero, in which case
+// the result is copied to it
+void syrk(gemm_uplo uplo, size_t n, size_t k, double alpha,
+          const double *A, size_t lda, double beta, double *C, size_t ldc, int mirror);
+
+// C (n x n) = A (n x k) * A^T, with both triangles of C filled
+void matmul_syrk(size_t n, size_t k, double **A, double **C);
+
+// Multi-threaded version of matmul(): C is split into a 2D grid of tiles, one per thread
+void matmul_parallel(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+void gemm_parallel(size_t m, size_t n, size_t p,
+                   const double *A, size_t lda,
+                   const double *B, size_t ldb,
+                   double beta, double *C, size_t ldc);
+
+// Splits nthreads into a rows x cols grid of tiles for an m x n matrix
+void gemm_grid(int nthreads, size_t m, size_t n, int *rows, int *cols);
+
+// Zeroes a matrix using the thread-to-tile mapping of gemm_parallel() so that
+// its pages are placed in the NUMA node of the thread that uses them
+void gemm_first_touch(size_t m, size_t n, double *C, size_t ldc);
+void first_touch_matrix(double **mat, size_t rows, size_t cols);
+
+// Strassen-Winograd version of matmul(), recursing while all the dimensions
+// are larger than the cutover size (see strassen_set_cutover())
+void matmul_strassen(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+void strassen_set_cutover(size_t cutover);
+
+// Number of doubles of workspace needed by gemm_strassen()
+size_t strassen_workspace_size(size_t m, size_t n, size_t p, size_t cutover);
+
+// Returns zero if workspace is NULL and it cannot be allocated internally
+int gemm_strassen(size_t m, size_t n, size_t p,
+                  const double *A, size_t lda,
+                  const double *B, size_t ldb,
+                  double *C, size_t ldc,
+                  double *workspace, size_t cutover);
+
+// Cache-oblivious version of matmul(): the operands are converted to Morton
+// order (see MortonMatrix) and multiplied recursively, with no cache blocking
+// parameters to tune for each machine
+void matmul_morton(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+// Returns zero if the dimensions of the matrices do not match
+int gemm_morton(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C);
+
+// Block-sparse version of matmul(): the operands are converted to the
+// BlockSparseMatrix format and only the products of pairs of nonzero tiles
+// are computed, which pays off when most of the tiles are zero
+void matmul_block_sparse(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+// C (A->rows x B->cols, dense) = A * B; returns zero if the dimensions of the
+// matrices do not match or the packing buffers cannot be allocated
+int gemm_block_sparse(const BlockSparseMatrix *A, const BlockSparseMatrix *B,
+                      double *C, size_t ldc);
+
+#endif
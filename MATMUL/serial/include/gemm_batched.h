@@ -0,0 +1,44 @@
+#pragma once
+#ifndef _GEMM_BATCHED_H_
+#define _GEMM_BATCHED_H_
+
+#include <stdlib.h>
+
+/*   Batched multiplication of many small matrices of the same shape
+
+     C[b] (m x n) = A[b] (m x p) * B[b] (p x n) for b in [0, count)
+
+     Strided layout: each matrix is stored linearized (row-major, ld == cols)
+     and matrix b begins at A + b * strideA.
+
+     Interleaved layout: matrices are grouped by GEMM_BATCH_LANES, and each
+     group stores the same element of all its matrices together, so that the
+     SIMD lanes run across the matrices of the group:
+
+       group g = { X[g*L][0][0], X[g*L+1][0][0], ..., X[g*L+L-1][0][0],
+                   X[g*L][0][1], X[g*L+1][0][1], ... }
+
+     The last group is zero-padded when count is not a multiple of the lanes.
+     Square sizes 4, 8, 16 and 32 use fully specialized kernels.
+*/
+
+#define GEMM_BATCH_LANES 8
+
+void gemm_batched(size_t m, size_t n, size_t p, size_t count,
+                  const double *A, size_t strideA,
+                  const double *B, size_t strideB,
+                  double *C, size_t strideC);
+
+void gemm_batched_interleaved(size_t m, size_t n, size_t p, size_t count,
+                              const double *A, const double *B, double *C);
+
+// Number of doubles needed to store count rows x cols matrices interleaved
+size_t batch_interleaved_size(size_t rows, size_t cols, size_t count);
+
+// Conversions between the strided and the interleaved layouts
+void batch_interleave(size_t rows, size_t cols, size_t count,
+                      const double *src, size_t stride, double *dst);
+void batch_deinterleave(size_t rows, size_t cols, size_t count,
+                        const double *src, double *dst, size_t stride);
+
+#endif
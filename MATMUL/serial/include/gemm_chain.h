@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _GEMM_CHAIN_H_
+#define _GEMM_CHAIN_H_
+
+#include <stdlib.h>
+
+/*   Multiplication of a chain of matrices C = A[0] * A[1] * ... * A[count-1]
+
+     Matrix A[i] is dims[i] x dims[i+1]. The plan chooses the parenthesization
+     that needs the fewest flops (dynamic programming over the shapes, O(count^3))
+     and lists its products in evaluation order. Intermediate results are kept
+     in a pool of buffers allocated once with the plan: a product releases the
+     buffers of its operands, so a left-deep or right-deep order alternates
+     between two of them (ping-pong) and balanced orders need a few more. The
+     last product is written directly to C.
+*/
+
+// Operand of a product: an input matrix of the chain or a buffer of the pool
+typedef struct gemm_chain_operand {
+    int temp;     // Non-zero for a buffer of the pool
+    size_t index; // Index of the input matrix or of the buffer
+} gemm_chain_operand;
+
+typedef struct gemm_chain_step {
+    size_t m, n, p; // out (m x n) = left (m x p) * right (p x n)
+    gemm_chain_operand left, right;
+    size_t out; // Buffer of the pool receiving the result (unused by the last step)
+} gemm_chain_step;
+
+typedef struct gemm_chain {
+    size_t count;
+    size_t *dims;           // count + 1 dimensions
+    size_t *split;          // split[i * count + j]: A[i..j] = A[i..s] * A[s+1..j]
+    gemm_chain_step *steps; // count - 1 products in evaluation order
+    double flops;           // Flops of the chosen order
+    size_t num_buffers;
+    size_t buffer_size;     // Doubles per buffer (the largest intermediate)
+    double **buffers;
+} gemm_chain;
+
+// Plans the chain and allocates its buffers; returns NULL if count is zero, a
+// dimension is zero or there is not enough memory
+gemm_chain *gemm_chain_new(size_t count, const size_t *dims);
+void gemm_chain_delete(gemm_chain *chain);
+
+// Flops needed to evaluate the chain from left to right, for comparison
+double gemm_chain_flops_left(size_t count, const size_t *dims);
+
+// Writes the chosen parenthesization, eg. "((A0 A1) A2)", to a string of at
+// least size bytes (truncated if needed)
+void gemm_chain_format(const gemm_chain *chain, char *str, size_t size);
+
+// Evaluates the chain over matrices created with new_matrix(); mats[i] is
+// dims[i] x dims[i+1] and C is dims[0] x dims[count]
+void gemm_chain_run(const gemm_chain *chain, double **const mats[], double **C);
+
+// Plans and evaluates a chain in a single call; returns zero if it cannot be planned
+int matmul_chain(size_t count, const size_t *dims, double **const mats[], double **C);
+
+#endif
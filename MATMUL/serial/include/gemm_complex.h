@@ -0,0 +1,59 @@
+#pragma once
+#ifndef _GEMM_COMPLEX_H_
+#define _GEMM_COMPLEX_H_
+
+#include <stdlib.h>
+
+/*   Complex matrix multiplication on top of the real packed engine
+
+     A complex matrix is described by the addresses of the real and imaginary
+     parts of its first element and the strides (in doubles) between rows and
+     columns, which are shared by both parts. This covers the two usual
+     storages without copying them:
+
+       interleaved: { re00, im00, re01, im01, ... }, rs = 2 * ld, cs = 2
+       planar:      re = { re00, re01, ... }, im = { im00, im01, ... }, rs = ld, cs = 1
+
+     4M computes the real and imaginary parts with four real products:
+
+       Cr = Ar Br - Ai Bi
+       Ci = Ar Bi + Ai Br
+
+     3M (Karatsuba) needs three, at the cost of O(n^2) extra additions and
+     temporaries:
+
+       T1 = Ar Br, T2 = Ai Bi, T3 = (Ar + Ai) (Br + Bi)
+       Cr = T1 - T2
+       Ci = T3 - T1 - T2
+
+     3M saves a quarter of the flops, but the error of Ci is bounded by
+     |Ar + Ai| |Br + Bi| rather than by |A| |B|, so it is less accurate when
+     the terms cancel. 4M is as accurate as the real engine.
+*/
+
+typedef enum {
+    GEMM_COMPLEX_AUTO, // 3M for large products, 4M otherwise
+    GEMM_COMPLEX_4M,   // Accuracy of the real engine
+    GEMM_COMPLEX_3M    // 25% fewer flops, weaker error bound for Ci
+} gemm_complex_algo;
+
+typedef struct complex_matrix {
+    double *re, *im; // Real and imaginary parts of element (0, 0)
+    size_t rs, cs;   // Strides between rows and between columns, in doubles
+} complex_matrix;
+
+// Views of a row-major matrix stored interleaved or in two planes; ld counts
+// complex elements in both cases
+complex_matrix complex_interleaved(double *data, size_t ld);
+complex_matrix complex_planar(double *re, double *im, size_t ld);
+
+// C (m x n) = alpha * A (m x p) * B (p x n) + beta * C, with real alpha and
+// beta; C is not read when beta is zero. 3M falls back to 4M if its
+// temporaries cannot be allocated
+void gemm_complex(gemm_complex_algo algo, size_t m, size_t n, size_t p, double alpha,
+                  complex_matrix A, complex_matrix B, double beta, complex_matrix C);
+
+// Algorithm used by gemm_complex() for a product (resolves GEMM_COMPLEX_AUTO)
+gemm_complex_algo gemm_complex_select(gemm_complex_algo algo, size_t m, size_t n, size_t p);
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef _GEMM_INT_H_
+#define _GEMM_INT_H_
+
+#include <stdlib.h>
+
+/*   Exact multiplication of matrices holding small integers
+
+     A and B are stored as int8 or int16 (row-major, with a leading dimension)
+     and multiplied with integer SIMD instructions: pairs of int16 products are
+     added into int32 lanes (AVX2 vpmaddwd, or AVX-512 VNNI vpdpwssd). The depth
+     of each block is bounded by the value ranges so that the int32 sums cannot
+     overflow, and the blocks are added into the double C. The result is exact,
+     and thus identical to the double path, while |C| < 2^53.
+
+     int16 values are limited to [-32767, 32767] so that a pair of products
+     always fits in an int32 lane.
+*/
+
+typedef enum { GEMM_INT8, GEMM_INT16 } gemm_int_type;
+
+// Bytes per element of each type
+size_t gemm_int_size(gemm_int_type type);
+
+// Returns non-zero if all the values of X are integers that fit in an int16,
+// and stores the largest absolute value in absmax
+int gemm_int_range(size_t rows, size_t cols, const double *X, size_t ldx, int *absmax);
+
+// Narrowest type holding values in [-absmax, absmax]
+gemm_int_type gemm_int_type_for(int absmax);
+
+// Converts X to the selected type; values must fit in it
+void gemm_int_convert(size_t rows, size_t cols, const double *X, size_t ldx,
+                      gemm_int_type type, void *dst, size_t ldd);
+
+// C (m x n) = A (m x p) * B (p x n), where amax and bmax bound the absolute
+// values of A and B
+void gemm_int(size_t m, size_t n, size_t p,
+              gemm_int_type typeA, const void *A, size_t lda, int amax,
+              gemm_int_type typeB, const void *B, size_t ldb, int bmax,
+              double *C, size_t ldc);
+
+// Name of the integer micro-kernel for the running CPU
+const char *gemm_int_kernel_name(void);
+
+// Integer version of matmul(): A and B are checked and converted to the
+// narrowest integer type, falling back to matmul_packed() if they do not fit
+void matmul_int(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+
+// Sets the largest absolute value of the inputs of matmul_int(), which then
+// trusts it instead of checking the data (zero restores the checks)
+void matmul_int_set_range(size_t absmax);
+
+#endif
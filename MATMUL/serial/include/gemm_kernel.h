@@ -0,0 +1,66 @@
+#pragma once
+#ifndef _GEMM_KERNEL_H_
+#define _GEMM_KERNEL_H_
+
+#include <stdlib.h>
+
+/*   Micro-kernels of the packed GEMM engine
+
+     A micro-kernel computes a MR x NR tile of C = alpha * A * B + beta * C,
+     where A is a MR x kc micro-panel and B a kc x NR micro-panel packed as
+     follows:
+
+       a = { A[0][0], A[1][0], ..., A[MR-1][0], A[0][1], A[1][1], ... }
+       b = { B[0][0], B[0][1], ..., B[0][NR-1], B[1][0], B[1][1], ... }
+
+     Packed micro-panels are aligned to GEMM_ALIGNMENT bytes. The C tile is
+     addressed through its leading dimension ldc and needs no alignment. When
+     beta is zero, C is only written (never read).
+*/
+
+#define GEMM_ALIGNMENT 64
+
+// Largest micro-tile among all the available kernels
+#define GEMM_MAX_MR 12
+#define GEMM_MAX_NR 16
+
+typedef void (*gemm_ukernel_fn)(size_t kc, const double *a, const double *b,
+                                double alpha, double *c, size_t ldc, double beta);
+
+typedef struct gemm_kernel {
+    const char *name;
+    size_t mr, nr;     // Micro-tile computed in registers
+    size_t mc, kc, nc; // Cache blocking (multiples of mr and nr)
+    gemm_ukernel_fn fn;
+} gemm_kernel;
+
+// Returns the best kernel for the running CPU; the choice is made on the first
+// call and can be overridden through the MATMUL_KERNEL environment variable
+const gemm_kernel *gemm_kernel_get(void);
+
+// Returns the kernel with the selected name, or NULL if it is not supported
+const gemm_kernel *gemm_kernel_find(const char *name);
+
+/*   Building blocks of the packed engine, for engines that choose their own
+     blocks (element (i, j) of each operand X is X[i * rsx + j * csx])
+*/
+
+struct gemm_epilogue;
+
+// Packs a mc x kc block of A into micro-panels of mr rows (zero-padded)
+void gemm_pack_a(size_t mc, size_t kc, const double *A, size_t rsa, size_t csa,
+                 size_t mr, double *Ap);
+
+// Packs a kc x nc panel of B into micro-panels of nr columns (zero-padded)
+void gemm_pack_b(size_t kc, size_t nc, const double *B, size_t rsb, size_t csb,
+                 size_t nr, double *Bp);
+
+// C (mc x nc) = alpha * Ap * Bp + beta * C with the micro-kernel of kern, which
+// must be the one used to pack both operands; ep is the epilogue to apply to
+// each tile (NULL for none) and (i0, j0) the position of C in the whole matrix
+void gemm_macro_kernel(const gemm_kernel *kern, size_t mc, size_t nc, size_t kc,
+                       double alpha, const double *Ap, const double *Bp,
+                       double beta, double *C, size_t rsc, size_t csc,
+                       const struct gemm_epilogue *ep, size_t i0, size_t j0);
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef _GEMM_OOC_H_
+#define _GEMM_OOC_H_
+
+#include <stdlib.h>
+
+/*   Out-of-core multiplication of matrices stored in binary files
+
+     Each matrix is a file holding its rows x cols doubles in row-major order
+     (ld == cols, no header), which is memory-mapped as a whole. gemm_ooc()
+     streams square tiles of A, B and C through a fixed memory budget: while
+     one thread multiplies the current tiles, a second one reads the next ones
+     and writes back the finished tile of C, so I/O overlaps with computation.
+     Pages of the mappings are released as soon as each tile is copied, so the
+     resident memory stays close to the budget regardless of the matrix size.
+*/
+
+typedef struct ooc_matrix {
+    size_t rows, cols;
+    size_t bytes;
+    double *data; // Shared mapping of the whole file
+    int fd;
+} ooc_matrix;
+
+typedef struct gemm_ooc_stats {
+    size_t tile;         // Side of the square tiles
+    double compute_time; // Seconds spent multiplying tiles
+    double io_time;      // Seconds spent reading and writing tiles
+    double io_bytes;     // Bytes read and written
+} gemm_ooc_stats;
+
+// Creates (or truncates) a file for a rows x cols matrix and maps it; returns
+// NULL if the file cannot be created or mapped
+ooc_matrix *ooc_create(const char *path, size_t rows, size_t cols);
+
+// Maps an existing file holding a rows x cols matrix
+ooc_matrix *ooc_open(const char *path, size_t rows, size_t cols);
+
+// Unmaps the matrix and closes its file (the file is kept)
+void ooc_close(ooc_matrix *mat);
+
+// Streaming counterparts of rand_matrix() and checksum_matrix()
+void ooc_rand(ooc_matrix *mat);
+double ooc_checksum(const ooc_matrix *mat);
+
+// Side of the tiles used by gemm_ooc() for a memory budget in bytes, or zero if
+// the budget cannot hold the buffers of the smallest tiles
+size_t gemm_ooc_tile(size_t budget);
+
+// C (m x n) = A (m x p) * B (p x n) using at most budget bytes of tile buffers;
+// returns zero if the shapes do not match, the budget is too small or the
+// buffers cannot be allocated
+int gemm_ooc(const ooc_matrix *A, const ooc_matrix *B, ooc_matrix *C,
+             size_t budget, gemm_ooc_stats *stats);
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _GEMM_PREPARED_H_
+#define _GEMM_PREPARED_H_
+
+#include <stdlib.h>
+#include <gemm_kernel.h>
+
+/*   Right-hand operand packed once for many multiplications
+
+     The packed engine copies every kc x nc panel of B into the layout of the
+     micro-kernel on each call. When many matrices A are multiplied by the same
+     B, a prepared operand keeps all those panels, in the order in which the
+     engine visits them, and later products go straight to the micro-kernel:
+
+       panels = { B[0:kc, 0:nc], B[kc:2kc, 0:nc], ..., B[0:kc, nc:2nc], ... }
+
+     The panels take as much memory as B (its columns rounded up to nr). The
+     handle remembers where B is, so after B changes it only has to be
+     invalidated: the next product repacks it. A handle that may be repacked
+     must not be used by several threads at once.
+*/
+
+typedef struct gemm_prepared {
+    size_t p, n;              // B is p x n
+    const double *B;          // Source of the panels
+    size_t ldb;
+    const gemm_kernel *kern;  // Kernel whose layout and blocking the panels follow
+    double *panels;
+    int valid;                // Zero if B changed since it was packed
+    unsigned long packs;      // Number of times B has been packed
+} gemm_prepared;
+
+// Packs B (p x n); B must outlive the handle. Returns NULL if there is not
+// enough memory
+gemm_prepared *gemm_prepare(size_t p, size_t n, const double *B, size_t ldb);
+void gemm_prepared_delete(gemm_prepared *prep);
+
+// Marks the panels as stale after B changes, so that the next product repacks
+// them (B must keep its dimensions and location)
+void gemm_prepared_invalidate(gemm_prepared *prep);
+
+// C (m x n) = alpha * A (m x p) * B + beta * C with the prepared B; C is not
+// read when beta is zero
+void gemm_prepared_mul(size_t m, double alpha, const double *A, size_t lda,
+                       gemm_prepared *prep, double beta, double *C, size_t ldc);
+
+#endif
@@ -1,3 +1,8 @@
+#pragma once
+#ifndef _MATRIX_H_
+#define _MATRIX_H_
+
+#include <stdint.h>
 #include <stdlib.h>
 
 /*   Matrices stored as a linearized array plus a row pointer array
@@ -11,9 +16,145 @@ b -> 0 0 3 => { 1, 0, 0, 0, 2, 0, 0, 0, 3 } => m[1][1] == 2
                                                    ^   == a[1*3+1] == *(m[0]+3+1)
                                                    |   == b[1]     == *(m[1]+1)
          The row pointer array enables this syntax +
+
+     Each row starts at a 64-byte boundary: rows are padded up to a leading
+     dimension (ld) that is a multiple of 8 doubles and, to avoid cache-set
+     aliasing, not a multiple of 128 doubles. The padding is not initialized.
+     The row pointer array is preceded by a Matrix descriptor, which can be
+     obtained with matrix_of().
 */
 
+// Allocation flags
+#define MATRIX_HUGE_PAGES 1 // Back the data with transparent huge pages (Linux)
+
+typedef struct Matrix {
+    size_t rows;
+    size_t cols;
+    size_t ld;    // Distance between the beginning of two rows (in doubles)
+    int flags;    // MATRIX_* flags actually in effect
+    double *data; // Linearized data (data == row[0])
+    void *alloc;  // Beginning of the allocation that holds the data
+    size_t bytes; // Size of the allocation that holds the data
+    double *row[];
+} Matrix;
+
+// Creates a matrix using the default flags (MATRIX_HUGE_PAGES is set when the
+// MATMUL_HUGE_PAGES environment variable is non-zero)
 double **new_matrix(size_t rows, size_t cols);
+double **new_matrix_flags(size_t rows, size_t cols, int flags);
 void delete_matrix(double **mat);
+
+// Returns the descriptor of a matrix created with new_matrix()
+Matrix *matrix_of(double **mat);
+
+// Returns the leading dimension of any matrix whose rows are evenly spaced
+size_t matrix_ld(double **mat, size_t rows, size_t cols);
+
 double **rand_matrix(double **mat, size_t rows, size_t cols);
 double checksum_matrix(double **mat, size_t rows, size_t cols);
+
+// Checks C (m x n) == A (m x p) * B (p x n) with Freivalds' algorithm: for
+// each of k random vectors x of +-1 entries, A (B x) is compared with C x in
+// O(n^2) operations. A wrong C passes each vector with a probability of at most
+// 1/2, so a wrong result goes unnoticed with a probability of at most 2^-k.
+// Rounding is tolerated up to a bound proportional to p * eps * |A| |B| |x|.
+// Returns non-zero if C passes (zero also without memory for the vectors);
+// error (if not NULL) receives the largest difference relative to its bound.
+int verify_matmul(size_t m, size_t n, size_t p, double **A, double **B, double **C,
+                  unsigned k, double *error);
+
+/*   Matrices stored as blocks in Morton (Z-curve) order
+
+     The matrix is split into a 2^levels_rows x 2^levels_cols grid of blocks,
+     each one stored row-major and contiguously. The grid is laid out by halving
+     it recursively: along the rows while it has at least as many block rows as
+     block columns, and along the columns otherwise. Square grids thus follow
+     the Z-curve (top-left, top-right, bottom-left and bottom-right quadrants),
+     and every half or quadrant visited by a recursive algorithm is contiguous.
+
+       +---+---+---+---+
+       | 0 | 1 | 4 | 5 |
+       +---+---+---+---+
+       | 2 | 3 | 6 | 7 |
+       +---+---+---+---+
+       | 8 | 9 |12 |13 |
+       +---+---+---+---+
+       |10 |11 |14 |15 |
+       +---+---+---+---+
+
+     The block size is derived from each dimension alone (it does not depend
+     on the machine), so two matrices sharing a dimension are blocked in the
+     same way along it. Blocks are padded to a multiple of 8 doubles on each
+     side; the last blocks of each dimension may thus be partial or empty. The
+     padding is not initialized.
+*/
+typedef struct MortonMatrix {
+    size_t rows;
+    size_t cols;
+    size_t block_rows;    // Rows of each block
+    size_t block_cols;    // Columns of each block
+    unsigned levels_rows; // The grid has 2^levels_rows block rows
+    unsigned levels_cols; // The grid has 2^levels_cols block columns
+    double *data;         // Blocks in Morton order
+} MortonMatrix;
+
+MortonMatrix *new_morton(size_t rows, size_t cols);
+void delete_morton(MortonMatrix *mat);
+
+// Returns the first element of block (bi, bj)
+double *morton_block(const MortonMatrix *mat, size_t bi, size_t bj);
+
+// Conversions from and to the row-major layout of new_matrix(); both matrices
+// must have the same dimensions
+void to_morton(double **src, MortonMatrix *dst);
+void from_morton(const MortonMatrix *src, double **dst);
+
+/*   Block-sparse matrices that store only their nonzero tiles
+
+     The matrix is split into a grid of BLOCK_SPARSE_TILE x BLOCK_SPARSE_TILE
+     tiles, and an occupancy bitmap records which of them hold any nonzero
+     element. Only those are stored, row-major and zero-padded to the whole
+     tile, in the order of the grid (by tile rows, from left to right):
+
+       +---+---+---+
+       | 0 |   | 1 |      bitmap = { 101, 010 }
+       +---+---+---+      row_start = { 0, 2, 3 }
+       |   | 2 |   |      tiles = { tile 0, tile 1, tile 2 }
+       +---+---+---+
+
+     Each tile row of the bitmap takes a whole number of 64-bit words, with
+     tile column bj in bit bj % 64 of word bj / 64.
+*/
+#define BLOCK_SPARSE_TILE 48
+
+typedef struct BlockSparseMatrix {
+    size_t rows;
+    size_t cols;
+    size_t tile_rows;  // Rows of the grid of tiles
+    size_t tile_cols;  // Columns of the grid of tiles
+    size_t words;      // Words of the bitmap per tile row
+    uint64_t *bitmap;  // tile_rows * words words
+    size_t *row_start; // Index of the first tile of each tile row, and the count
+    double *tiles;     // Nonzero tiles
+} BlockSparseMatrix;
+
+// Creates a block-sparse copy of a matrix created with new_matrix()
+BlockSparseMatrix *new_block_sparse(double **src, size_t rows, size_t cols);
+void delete_block_sparse(BlockSparseMatrix *mat);
+
+// Returns non-zero if tile (bi, bj) is stored
+int block_sparse_test(const BlockSparseMatrix *mat, size_t bi, size_t bj);
+
+// Conversion to the row-major layout of new_matrix(); both matrices must have
+// the same dimensions
+void from_block_sparse(const BlockSparseMatrix *src, double **dst);
+
+// Same as rand_matrix(), but only each BLOCK_SPARSE_TILE x BLOCK_SPARSE_TILE
+// tile with a probability of density (0 to 1) is filled; the others are zeroed
+double **rand_block_matrix(double **mat, size_t rows, size_t cols, double density);
+
+// Aligned scratch buffers for the optimized engines (64-byte alignment)
+void *new_buffer(size_t bytes);
+void delete_buffer(void *buf);
+
+#endif
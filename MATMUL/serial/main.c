@@ -1,6 +1,18 @@
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <matrix.h>
 #include <clock.h>
+#include <gemm.h>
+#include <gemm_batched.h>
+#include <gemm_chain.h>
+#include <gemm_complex.h>
+#include <gemm_int.h>
+#include <gemm_kernel.h>
+#include <gemm_ooc.h>
+#include <gemm_prepared.h>
+#include <perf_counters.h>
+#include <transpose.h>
 
 // C (m x n) = A (m x p) * B (p x n)
 void matmul(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
@@ -21,20 +33,880 @@ void matmul(size_t m, size_t n, size_t p, double **A, double **B, double **C) {
     }
 }
 
+typedef void (*matmul_fn)(size_t m, size_t n, size_t p, double **A, double **B, double **C);
+typedef void (*touch_fn)(double **mat, size_t rows, size_t cols);
+typedef void (*param_fn)(size_t value);
+typedef double (*checksum_fn)(void);
+
+// Matrix multiplication algorithms that can be selected from the command line;
+// multi-threaded ones provide a first-touch function to place the matrix pages,
+// tunable ones a function to set their optional parameter, and those that
+// compute the checksum of C on the fly a function to return it (NaN if they
+// ran out of memory for it)
+static const struct {
+    const char *name;
+    matmul_fn fn;
+    touch_fn touch;
+    param_fn set_param;
+    const char *param_desc;
+    checksum_fn checksum;
+} algorithms[] = {
+    {"naive", matmul, NULL, NULL, NULL, NULL},
+    {"blocked", matmul_blocked, NULL, NULL, NULL, NULL},
+    {"packed", matmul_packed, NULL, NULL, NULL, NULL},
+    {"parallel", matmul_parallel, first_touch_matrix, NULL, NULL, NULL},
+    {"strassen", matmul_strassen, NULL, strassen_set_cutover, "cutover", NULL},
+    {"int", matmul_int, NULL, matmul_int_set_range, "range", NULL},
+    {"morton", matmul_morton, NULL, NULL, NULL, NULL},
+    {"fused", matmul_fused, NULL, matmul_fused_set_clamp, "clamp", matmul_fused_checksum},
+    {"sparse", matmul_block_sparse, NULL, NULL, NULL, NULL},
+};
+static const size_t num_algorithms = sizeof(algorithms) / sizeof(algorithms[0]);
+
+// Benchmarks multiplying many n x n matrices at once
+static int bench_batched(size_t n, unsigned long count) {
+    const int iters = 10;
+    if (!count)
+        count = (1 << 22) / (n * n);
+    printf("count\t= %lu\n", count);
+
+    const size_t size = n * n;
+    const size_t ilv_size = batch_interleaved_size(n, n, count);
+    double *A = (double *)new_buffer(count * size * sizeof(double));
+    double *B = (double *)new_buffer(count * size * sizeof(double));
+    double *C = (double *)new_buffer(count * size * sizeof(double));
+    double *Ai = (double *)new_buffer(ilv_size * sizeof(double));
+    double *Bi = (double *)new_buffer(ilv_size * sizeof(double));
+    double *Ci = (double *)new_buffer(ilv_size * sizeof(double));
+    if (!A || !B || !C || !Ai || !Bi || !Ci) {
+        printf("Error: not enough memory to run the test using %lu matrices\n", count);
+        return 1;
+    }
+    for (size_t e = 0; e < count * size; e++)
+        A[e] = rand() % 10;
+    for (size_t e = 0; e < count * size; e++)
+        B[e] = rand() % 10;
+    batch_interleave(n, n, count, A, size, Ai);
+    batch_interleave(n, n, count, B, size, Bi);
+
+    printf("- Executing test...\n");
+    double time_start = getClock();
+    for (int iters_done = 0; iters_done < iters; iters_done++)
+        gemm_batched(n, n, n, count, A, size, B, size, C, size);
+    double time_strided = (getClock() - time_start) / iters;
+
+    time_start = getClock();
+    for (int iters_done = 0; iters_done < iters; iters_done++)
+        gemm_batched_interleaved(n, n, n, count, Ai, Bi, Ci);
+    double time_interleaved = (getClock() - time_start) / iters;
+
+    // Both layouts must produce the same result
+    double checksum = 0.0, checksum_ilv = 0.0;
+    for (size_t e = 0; e < count * size; e++)
+        checksum += C[e];
+    for (size_t e = 0; e < ilv_size; e++)
+        checksum_ilv += Ci[e];
+
+    const double flops = 2.0 * n * n * n * count;
+    printf("time (s)= %.6f\n", time_interleaved);
+    printf("size\t= %zu\n", n);
+    printf("mat/s\t= %.3e (interleaved)\n", count / time_interleaved);
+    printf("mat/s\t= %.3e (strided)\n", count / time_strided);
+    printf("gflop/s\t= %.2f (interleaved)\n", flops / time_interleaved * 1e-9);
+    printf("chksum\t= %.0f\n", checksum);
+    if (checksum != checksum_ilv)
+        printf("Error: interleaved chksum %.0f differs\n", checksum_ilv);
+    printf("iters\t= %i\n", iters);
+
+    delete_buffer(A);
+    delete_buffer(B);
+    delete_buffer(C);
+    delete_buffer(Ai);
+    delete_buffer(Bi);
+    delete_buffer(Ci);
+    return checksum != checksum_ilv;
+}
+
+// Benchmarks gemm() for every layout and transposition of n x n operands; the
+// operands are chosen so that every case computes the same product as matmul()
+static int bench_gemm(size_t n, unsigned long iters) {
+    static const char *const layout_names[] = {"row", "col"};
+    static const char trans_names[] = {'N', 'T'};
+    if (!iters)
+        iters = 1;
+
+    double **A = new_matrix(n, n), **At = new_matrix(n, n);
+    double **B = new_matrix(n, n), **Bt = new_matrix(n, n);
+    double **C = new_matrix(n, n);
+    if (!A || !At || !B || !Bt || !C) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(C)->ld;
+    rand_matrix(A, n, n);
+    rand_matrix(B, n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            At[j][i] = A[i][j];
+            Bt[j][i] = B[i][j];
+        }
+    }
+    matmul(n, n, n, A, B, C);
+    const double reference = checksum_matrix(C, n, n);
+    printf("ld\t= %zu\n", ld);
+    printf("chksum\t= %.0f (naive)\n", reference);
+
+    printf("- Executing test...\n");
+    int errors = 0;
+    for (int layout = GEMM_ROW_MAJOR; layout <= GEMM_COL_MAJOR; layout++) {
+        for (int ta = GEMM_NO_TRANS; ta <= GEMM_TRANS; ta++) {
+            for (int tb = GEMM_NO_TRANS; tb <= GEMM_TRANS; tb++) {
+                // A row-major matrix is the transpose of a column-major one
+                const int swap = layout == GEMM_COL_MAJOR;
+                const double *a = (ta == GEMM_TRANS) != swap ? At[0] : A[0];
+                const double *b = (tb == GEMM_TRANS) != swap ? Bt[0] : B[0];
+
+                double time_start = getClock();
+                for (unsigned long it = 0; it < iters; it++)
+                    gemm(layout, ta, tb, n, n, n, 1.0, a, ld, b, ld, 0.0, C[0], ld);
+                double time = (getClock() - time_start) / iters;
+                double checksum = checksum_matrix(C, n, n);
+
+                // C = 2 * A * B - C must leave the product unchanged
+                gemm(layout, ta, tb, n, n, n, 2.0, a, ld, b, ld, -1.0, C[0], ld);
+                double checksum_ab = checksum_matrix(C, n, n);
+
+                printf("%s %c%c\t= %.6f s, %.2f gflop/s, chksum %.0f\n",
+                       layout_names[layout], trans_names[ta], trans_names[tb],
+                       time, 2.0 * n * n * n / time * 1e-9, checksum);
+                if (checksum != reference || checksum_ab != reference) {
+                    printf("Error: chksum differs from the naive one\n");
+                    errors++;
+                }
+            }
+        }
+    }
+    printf("size\t= %zu\n", n);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(A);
+    delete_matrix(At);
+    delete_matrix(B);
+    delete_matrix(Bt);
+    delete_matrix(C);
+    return errors != 0;
+}
+
+// Sums the real and imaginary parts of a complex matrix
+static double checksum_complex(size_t rows, size_t cols, complex_matrix mat) {
+    double checksum = 0.0;
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            checksum += mat.re[i * mat.rs + j * mat.cs] + mat.im[i * mat.rs + j * mat.cs];
+    return checksum;
+}
+
+// Benchmarks the product of n x n complex matrices: emulated with four calls to
+// matmul_packed() and two temporaries, and with gemm_complex() using 4M and 3M
+// on planar and interleaved storage
+static int bench_complex(size_t n, unsigned long iters) {
+    static const char *const algo_names[] = {"auto", "4m", "3m"};
+    if (!iters)
+        iters = 1;
+
+    double **Ar = new_matrix(n, n), **Ai = new_matrix(n, n);
+    double **Br = new_matrix(n, n), **Bi = new_matrix(n, n);
+    double **Cr = new_matrix(n, n), **Ci = new_matrix(n, n);
+    double **T1 = new_matrix(n, n), **T2 = new_matrix(n, n);
+    double *Ailv = (double *)new_buffer(2 * n * n * sizeof(double));
+    double *Bilv = (double *)new_buffer(2 * n * n * sizeof(double));
+    double *Cilv = (double *)new_buffer(2 * n * n * sizeof(double));
+    if (!Ar || !Ai || !Br || !Bi || !Cr || !Ci || !T1 || !T2 || !Ailv || !Bilv || !Cilv) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(Cr)->ld;
+    rand_matrix(Ar, n, n);
+    rand_matrix(Ai, n, n);
+    rand_matrix(Br, n, n);
+    rand_matrix(Bi, n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            Ailv[2 * (i * n + j)] = Ar[i][j];
+            Ailv[2 * (i * n + j) + 1] = Ai[i][j];
+            Bilv[2 * (i * n + j)] = Br[i][j];
+            Bilv[2 * (i * n + j) + 1] = Bi[i][j];
+        }
+    }
+
+    printf("- Executing test...\n");
+    const double flops = 8.0 * n * n * n;
+    double time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++) {
+        matmul_packed(n, n, n, Ar, Br, T1);
+        matmul_packed(n, n, n, Ai, Bi, T2);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                Cr[i][j] = T1[i][j] - T2[i][j];
+        matmul_packed(n, n, n, Ar, Bi, T1);
+        matmul_packed(n, n, n, Ai, Br, T2);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                Ci[i][j] = T1[i][j] + T2[i][j];
+    }
+    double time = (getClock() - time_start) / iters;
+    const double reference = checksum_complex(n, n, complex_planar(Cr[0], Ci[0], ld));
+    printf("emulated\t= %.6f s, %.2f gflop/s, chksum %.0f\n", time, flops / time * 1e-9, reference);
+
+    int errors = 0;
+    for (int interleaved = 0; interleaved <= 1; interleaved++) {
+        for (int algo = GEMM_COMPLEX_4M; algo <= GEMM_COMPLEX_3M; algo++) {
+            const complex_matrix A = interleaved ? complex_interleaved(Ailv, n) : complex_planar(Ar[0], Ai[0], ld);
+            const complex_matrix B = interleaved ? complex_interleaved(Bilv, n) : complex_planar(Br[0], Bi[0], ld);
+            const complex_matrix C = interleaved ? complex_interleaved(Cilv, n) : complex_planar(Cr[0], Ci[0], ld);
+
+            time_start = getClock();
+            for (unsigned long it = 0; it < iters; it++)
+                gemm_complex((gemm_complex_algo)algo, n, n, n, 1.0, A, B, 0.0, C);
+            time = (getClock() - time_start) / iters;
+            const double checksum = checksum_complex(n, n, C);
+
+            // Nominal flops of 4M, so that the rates compare the time of each version
+            printf("%s %s\t= %.6f s, %.2f gflop/s, chksum %.0f\n",
+                   interleaved ? "interleaved" : "planar", algo_names[algo],
+                   time, flops / time * 1e-9, checksum);
+            if (checksum != reference) {
+                printf("Error: chksum differs from the emulated one\n");
+                errors++;
+            }
+        }
+    }
+    printf("size\t= %zu\n", n);
+    printf("auto\t= %s\n", algo_names[gemm_complex_select(GEMM_COMPLEX_AUTO, n, n, n)]);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(Ar);
+    delete_matrix(Ai);
+    delete_matrix(Br);
+    delete_matrix(Bi);
+    delete_matrix(Cr);
+    delete_matrix(Ci);
+    delete_matrix(T1);
+    delete_matrix(T2);
+    delete_buffer(Ailv);
+    delete_buffer(Bilv);
+    delete_buffer(Cilv);
+    return errors != 0;
+}
+
+// Benchmarks a product followed by a bias add, a ReLU and the row sums of C,
+// either as separate passes over C or fused into the epilogue of the product
+static int bench_epilogue(size_t n, unsigned long iters) {
+    if (!iters)
+        iters = 1;
+
+    double **A = new_matrix(n, n), **B = new_matrix(n, n), **C = new_matrix(n, n);
+    double *bias = (double *)new_buffer(n * sizeof(double));
+    double *sums = (double *)new_buffer(n * sizeof(double));
+    double *sums_fused = (double *)new_buffer(n * sizeof(double));
+    if (!A || !B || !C || !bias || !sums || !sums_fused) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(C)->ld;
+    rand_matrix(A, n, n);
+    rand_matrix(B, n, n);
+    // Centered on the mean of the products so that the ReLU clamps about half of them
+    for (size_t j = 0; j < n; j++)
+        bias[j] = -20.25 * n + rand() % 10;
+
+    printf("- Executing test...\n");
+    double time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++) {
+        gemm_packed(n, n, n, A[0], ld, B[0], ld, 0.0, C[0], ld);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                C[i][j] += bias[j];
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                C[i][j] = C[i][j] < 0.0 ? 0.0 : C[i][j];
+        for (size_t i = 0; i < n; i++) {
+            sums[i] = 0.0;
+            for (size_t j = 0; j < n; j++)
+                sums[i] += C[i][j];
+        }
+    }
+    double time_passes = (getClock() - time_start) / iters;
+
+    const gemm_epilogue ep = {NULL, bias, 1, 0.0, INFINITY, sums_fused};
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        gemm_fused(n, n, n, 1.0, A[0], ld, B[0], ld, 0.0, C[0], ld, &ep);
+    double time_fused = (getClock() - time_start) / iters;
+
+    // Integer data: the sums are exact in both cases
+    double checksum = 0.0, checksum_fused = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        checksum += sums[i];
+        checksum_fused += sums_fused[i];
+    }
+
+    const double flops = 2.0 * n * n * n;
+    printf("time (s)= %.6f (fused), %.6f (separate passes)\n", time_fused, time_passes);
+    printf("size\t= %zu\n", n);
+    printf("gflop/s\t= %.2f (fused), %.2f (separate passes)\n",
+           flops / time_fused * 1e-9, flops / time_passes * 1e-9);
+    printf("chksum\t= %.0f\n", checksum_fused);
+    if (checksum != checksum_fused)
+        printf("Error: separate passes chksum %.0f differs\n", checksum);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(A);
+    delete_matrix(B);
+    delete_matrix(C);
+    delete_buffer(bias);
+    delete_buffer(sums);
+    delete_buffer(sums_fused);
+    return checksum != checksum_fused;
+}
+
+// Benchmarks A * A^T for a n x n matrix A: matmul_packed() on an explicit
+// transposed copy against syrk() on one triangle, mirrored or not
+static int bench_syrk(size_t n, unsigned long iters) {
+    if (!iters)
+        iters = 1;
+
+    double **A = new_matrix(n, n), **At = new_matrix(n, n);
+    double **C = new_matrix(n, n), **S = new_matrix(n, n);
+    if (!A || !At || !C || !S) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(S)->ld;
+    rand_matrix(A, n, n);
+
+    printf("- Executing test...\n");
+    double time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++) {
+        transpose(n, n, A[0], ld, At[0], ld);
+        matmul_packed(n, n, n, A, At, C);
+    }
+    double time_gemm = (getClock() - time_start) / iters;
+
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        syrk(GEMM_LOWER, n, n, 1.0, A[0], ld, 0.0, S[0], ld, 0);
+    double time_triangle = (getClock() - time_start) / iters;
+
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        matmul_syrk(n, n, A, S);
+    double time_mirror = (getClock() - time_start) / iters;
+
+    const double checksum = checksum_matrix(C, n, n);
+    const double checksum_syrk = checksum_matrix(S, n, n);
+    printf("time (s)= %.6f (syrk), %.6f (syrk + mirror), %.6f (transpose + gemm)\n",
+           time_triangle, time_mirror, time_gemm);
+    printf("size\t= %zu\n", n);
+    printf("speedup\t= %.2f (syrk), %.2f (syrk + mirror)\n",
+           time_gemm / time_triangle, time_gemm / time_mirror);
+    printf("chksum\t= %.0f\n", checksum_syrk);
+    if (checksum != checksum_syrk)
+        printf("Error: transpose + gemm chksum %.0f differs\n", checksum);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(A);
+    delete_matrix(At);
+    delete_matrix(C);
+    delete_matrix(S);
+    return checksum != checksum_syrk;
+}
+
+// Benchmarks the out-of-core multiplication of n x n matrices stored in files,
+// within a memory budget given in MiB; the files are created in the directory
+// selected by MATMUL_OOC_DIR (default: the current one) and removed at the end
+static int bench_ooc(size_t n, unsigned long budget_mib) {
+    static const char *const names[] = {"matmul_ooc_A.bin", "matmul_ooc_B.bin", "matmul_ooc_C.bin"};
+    if (!budget_mib)
+        budget_mib = 256;
+    const size_t budget = (size_t)budget_mib << 20;
+    const char *dir = getenv("MATMUL_OOC_DIR");
+    if (!dir)
+        dir = ".";
+    printf("budget\t= %lu MiB\n", budget_mib);
+    printf("tile\t= %zu\n", gemm_ooc_tile(budget));
+    printf("dir\t= %s\n", dir);
+
+    char paths[3][4096];
+    ooc_matrix *mats[3];
+    for (int i = 0; i < 3; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s", dir, names[i]);
+        mats[i] = ooc_create(paths[i], n, n);
+        if (!mats[i]) {
+            printf("Error: cannot create the file '%s'\n", paths[i]);
+            for (int j = 0; j <= i; j++) {
+                ooc_close(mats[j]);
+                remove(paths[j]);
+            }
+            return 1;
+        }
+    }
+    ooc_rand(mats[0]);
+    ooc_rand(mats[1]);
+
+    printf("- Executing test...\n");
+    gemm_ooc_stats stats;
+    double time_start = getClock();
+    int done = gemm_ooc(mats[0], mats[1], mats[2], budget, &stats);
+    double time = getClock() - time_start;
+
+    double checksum = 0.0;
+    if (done) {
+        const double flops = 2.0 * n * n * n;
+        checksum = ooc_checksum(mats[2]);
+        printf("time (s)= %.6f\n", time);
+        printf("size\t= %zu\n", n);
+        printf("gflop/s\t= %.2f (compute), %.2f (overall)\n",
+               flops / stats.compute_time * 1e-9, flops / time * 1e-9);
+        printf("io gb/s\t= %.2f\n", stats.io_bytes / stats.io_time * 1e-9);
+        printf("io (GB)\t= %.2f\n", stats.io_bytes * 1e-9);
+        printf("chksum\t= %.0f\n", checksum);
+    } else {
+        printf("Error: not enough memory for the tiles using a budget of %lu MiB\n", budget_mib);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        ooc_close(mats[i]);
+        remove(paths[i]);
+    }
+    return !done;
+}
+
+// Benchmarks a chain of count matrices with random dimensions up to n: the
+// planned order against evaluating it from left to right with a new matrix
+// for every intermediate result
+static int bench_chain(size_t n, unsigned long count) {
+    if (!count)
+        count = 6;
+    printf("count\t= %lu\n", count);
+
+    size_t *dims = (size_t *)malloc((count + 1) * sizeof(size_t));
+    double ***mats = (double ***)calloc(count, sizeof(double **));
+    if (!dims || !mats || n < 1) {
+        printf("Error: cannot create a chain of %lu matrices\n", count);
+        free(dims);
+        free(mats);
+        return 1;
+    }
+    for (size_t i = 0; i <= count; i++)
+        dims[i] = 1 + rand() % n;
+    printf("dims\t=");
+    for (size_t i = 0; i <= count; i++)
+        printf(" %zu", dims[i]);
+    printf("\n");
+
+    gemm_chain *chain = gemm_chain_new(count, dims);
+    double **C = new_matrix(dims[0], dims[count]);
+    int ok = chain && C;
+    for (size_t i = 0; ok && i < count; i++) {
+        mats[i] = rand_matrix(new_matrix(dims[i], dims[i + 1]), dims[i], dims[i + 1]);
+        ok = mats[i] != NULL;
+    }
+    if (!ok) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+    } else {
+        char order[1024];
+        gemm_chain_format(chain, order, sizeof(order));
+        printf("order\t= %s\n", order);
+        printf("buffers\t= %zu of %zu doubles\n", chain->num_buffers, chain->buffer_size);
+
+        printf("- Executing test...\n");
+        double time_start = getClock();
+        gemm_chain_run(chain, (double **const *)mats, C);
+        double time = getClock() - time_start;
+        const double checksum = checksum_matrix(C, dims[0], dims[count]);
+
+        // Left to right, allocating every intermediate result
+        time_start = getClock();
+        double **T = mats[0];
+        for (size_t i = 1; T && i < count; i++) {
+            double **R = new_matrix(dims[0], dims[i + 1]);
+            if (R)
+                matmul_packed(dims[0], dims[i + 1], dims[i], T, mats[i], R);
+            if (T != mats[0])
+                delete_matrix(T);
+            T = R;
+        }
+        double time_left = getClock() - time_start;
+        if (!T) {
+            printf("Error: not enough memory to run the test using n = %zu\n", n);
+            ok = 0;
+        } else {
+            const double checksum_left = checksum_matrix(T, dims[0], dims[count]);
+            if (T != mats[0])
+                delete_matrix(T);
+
+            const double flops_left = gemm_chain_flops_left(count, dims);
+            printf("time (s)= %.6f (planned), %.6f (left to right)\n", time, time_left);
+            printf("gflop\t= %.3f (planned), %.3f (left to right)\n", chain->flops * 1e-9, flops_left * 1e-9);
+            printf("speedup\t= %.2f\n", time_left / time);
+            printf("chksum\t= %.6e\n", checksum);
+
+            // Both orders round differently, so the checksums are compared loosely
+            const double diff = checksum - checksum_left;
+            if ((diff < 0 ? -diff : diff) > 1e-9 * (checksum < 0 ? -checksum : checksum)) {
+                printf("Error: left to right chksum %.6e differs\n", checksum_left);
+                ok = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+        delete_matrix(mats[i]);
+    delete_matrix(C);
+    gemm_chain_delete(chain);
+    free(mats);
+    free(dims);
+    return !ok;
+}
+
+// Benchmarks the block-sparse engine against the dense packed one for n x n
+// operands with a decreasing fraction of nonzero tiles, to find the density
+// below which skipping the zero tiles pays off
+static int bench_sparsity(size_t n, unsigned long iters) {
+    static const double densities[] = {1.0, 0.9, 0.75, 0.5, 0.25, 0.1, 0.05, 0.01};
+    if (!iters)
+        iters = 1;
+
+    double **A = new_matrix(n, n), **B = new_matrix(n, n);
+    double **C = new_matrix(n, n), **S = new_matrix(n, n);
+    if (!A || !B || !C || !S) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(S)->ld;
+    printf("tile\t= %d\n", BLOCK_SPARSE_TILE);
+
+    printf("- Executing test...\n");
+    int errors = 0;
+    double crossover = 0.0;
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+        rand_block_matrix(A, n, n, densities[d]);
+        rand_block_matrix(B, n, n, densities[d]);
+
+        double time_start = getClock();
+        for (unsigned long it = 0; it < iters; it++)
+            matmul_packed(n, n, n, A, B, C);
+        double time_dense = (getClock() - time_start) / iters;
+
+        time_start = getClock();
+        BlockSparseMatrix *As = new_block_sparse(A, n, n);
+        BlockSparseMatrix *Bs = new_block_sparse(B, n, n);
+        double time_convert = getClock() - time_start;
+        if (!As || !Bs) {
+            printf("Error: not enough memory for the block-sparse copies\n");
+            delete_block_sparse(As);
+            delete_block_sparse(Bs);
+            errors++;
+            break;
+        }
+
+        time_start = getClock();
+        int ok = 1;
+        for (unsigned long it = 0; it < iters; it++)
+            ok &= gemm_block_sparse(As, Bs, S[0], ld);
+        double time_sparse = (getClock() - time_start) / iters;
+
+        // Fraction of the tiles of A actually stored
+        const double stored = (double)As->row_start[As->tile_rows] /
+                              (As->tile_rows * As->tile_cols);
+        const double checksum = checksum_matrix(C, n, n);
+        const double checksum_sparse = checksum_matrix(S, n, n);
+        printf("density %.2f\t= %.2f stored, dense %.6f s, sparse %.6f s (+%.6f s to convert), "
+               "speedup %.2f, chksum %.0f\n",
+               densities[d], stored, time_dense, time_sparse, time_convert,
+               time_dense / time_sparse, checksum_sparse);
+        if (!ok || checksum != checksum_sparse) {
+            printf("Error: dense chksum %.0f differs\n", checksum);
+            errors++;
+        }
+        // The densities decrease, so the first one that pays off is the crossover
+        if (crossover == 0.0 && time_sparse < time_dense)
+            crossover = densities[d];
+
+        delete_block_sparse(As);
+        delete_block_sparse(Bs);
+    }
+    if (crossover > 0.0)
+        printf("crossover\t= %.2f\n", crossover);
+    else
+        printf("crossover\t= none\n");
+    printf("size\t= %zu\n", n);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(A);
+    delete_matrix(B);
+    delete_matrix(C);
+    delete_matrix(S);
+    return errors != 0;
+}
+
+// Returns non-zero if B (cols x rows) is the transpose of A (rows x cols)
+static int is_transpose(size_t rows, size_t cols, double **A, double **B) {
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            if (B[j][i] != A[i][j])
+                return 0;
+    return 1;
+}
+
+// Benchmarks the transposition of n x n matrices, out of place and in place,
+// and of n x n/2 ones against a naive loop and memcpy; the bandwidth counts
+// every element once read and once written
+static int bench_transpose(size_t n, unsigned long iters) {
+    if (!iters)
+        iters = 1;
+
+    double **A = new_matrix(n, n), **B = new_matrix(n, n);
+    if (!A || !B) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t ld = matrix_of(A)->ld;
+    const double bytes = 2.0 * n * n * sizeof(double);
+    rand_matrix(A, n, n);
+    printf("tiles\t= %s\n", transpose_kernel());
+
+    printf("- Executing test...\n");
+    double time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        for (size_t i = 0; i < n; i++)
+            memcpy(B[i], A[i], n * sizeof(double));
+    double time = (getClock() - time_start) / iters;
+    printf("memcpy\t= %.6f s, %.2f GB/s\n", time, bytes / time * 1e-9);
+
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                B[j][i] = A[i][j];
+    time = (getClock() - time_start) / iters;
+    printf("naive\t= %.6f s, %.2f GB/s\n", time, bytes / time * 1e-9);
+    int errors = !is_transpose(n, n, A, B);
+
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        transpose(n, n, A[0], ld, B[0], ld);
+    time = (getClock() - time_start) / iters;
+    printf("square\t= %.6f s, %.2f GB/s\n", time, bytes / time * 1e-9);
+    errors += !is_transpose(n, n, A, B);
+
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        transpose(n, n / 2, A[0], ld, B[0], ld);
+    time = (getClock() - time_start) / iters;
+    printf("rect\t= %.6f s, %.2f GB/s\n", time, bytes / 2 / time * 1e-9);
+    errors += !is_transpose(n, n / 2, A, B);
+
+    // Every call undoes the previous one, so B ends up as A or as A^T
+    for (size_t i = 0; i < n; i++)
+        memcpy(B[i], A[i], n * sizeof(double));
+    time_start = getClock();
+    for (unsigned long it = 0; it < iters; it++)
+        transpose_square(n, B[0], ld);
+    time = (getClock() - time_start) / iters;
+    printf("inplace\t= %.6f s, %.2f GB/s\n", time, bytes / time * 1e-9);
+    if (iters % 2)
+        transpose_square(n, B[0], ld);
+    int restored = 1;
+    for (size_t i = 0; i < n; i++)
+        restored &= !memcmp(B[i], A[i], n * sizeof(double));
+    errors += !restored;
+
+    if (errors)
+        printf("Error: %d of the transposes are wrong\n", errors);
+    printf("size\t= %zu\n", n);
+    printf("iters\t= %lu\n", iters);
+
+    delete_matrix(A);
+    delete_matrix(B);
+    return errors != 0;
+}
+
+// Benchmarks multiplying a sequence of different A matrices (n / 8 x n, as a
+// batch of rows) by the same n x n B, packing B in every product against
+// preparing it once; the accumulated time of the prepared products includes
+// the preparation, so the speedup grows as it is amortized
+static int bench_prepared(size_t n, unsigned long iters) {
+    const size_t num_a = 4;
+    if (!iters)
+        iters = 64;
+    const size_t m = n / 8 > 0 ? n / 8 : 1;
+
+    double **A = new_matrix(num_a * m, n), **B = new_matrix(n, n);
+    double **C = new_matrix(m, n), **D = new_matrix(m, n);
+    if (!A || !B || !C || !D) {
+        printf("Error: not enough memory to run the test using n = %zu\n", n);
+        return 1;
+    }
+    const size_t lda = matrix_of(A)->ld, ldb = matrix_of(B)->ld, ldc = matrix_of(C)->ld;
+    rand_matrix(A, num_a * m, n);
+    rand_matrix(B, n, n);
+    printf("rows\t= %zu (A)\n", m);
+
+    printf("- Executing test...\n");
+    double time_start = getClock();
+    gemm_prepared *prep = gemm_prepare(n, n, B[0], ldb);
+    double time_prepared = getClock() - time_start;
+    if (!prep) {
+        printf("Error: not enough memory to prepare B\n");
+        return 1;
+    }
+    printf("prepare\t= %.6f s\n", time_prepared);
+
+    double time_packed = 0.0;
+    int errors = 0;
+    for (unsigned long it = 1; it <= iters; it++) {
+        const double *a = A[(it - 1) % num_a * m];
+        time_start = getClock();
+        gemm_packed(m, n, n, a, lda, B[0], ldb, 0.0, C[0], ldc);
+        time_packed += getClock() - time_start;
+
+        time_start = getClock();
+        gemm_prepared_mul(m, 1.0, a, lda, prep, 0.0, D[0], ldc);
+        time_prepared += getClock() - time_start;
+
+        if (checksum_matrix(C, m, n) != checksum_matrix(D, m, n))
+            errors++;
+        // Powers of two and the last iteration
+        if (!(it & (it - 1)) || it == iters)
+            printf("iters %lu\t= %.6f s (packed), %.6f s (prepared), speedup %.2f\n",
+                   it, time_packed, time_prepared, time_packed / time_prepared);
+    }
+
+    // After B changes, the invalidated handle must follow it
+    rand_matrix(B, n, n);
+    gemm_prepared_invalidate(prep);
+    gemm_packed(m, n, n, A[0], lda, B[0], ldb, 0.0, C[0], ldc);
+    gemm_prepared_mul(m, 1.0, A[0], lda, prep, 0.0, D[0], ldc);
+    const double checksum = checksum_matrix(D, m, n);
+    if (checksum_matrix(C, m, n) != checksum)
+        errors++;
+
+    printf("packs\t= %lu\n", prep->packs);
+    printf("chksum\t= %.0f\n", checksum);
+    if (errors)
+        printf("Error: %d products differ from gemm_packed()\n", errors);
+    printf("size\t= %zu\n", n);
+    printf("iters\t= %lu\n", iters);
+
+    gemm_prepared_delete(prep);
+    delete_matrix(A);
+    delete_matrix(B);
+    delete_matrix(C);
+    delete_matrix(D);
+    return errors != 0;
+}
+
+typedef int (*bench_fn)(size_t n, unsigned long param);
+
+// Benchmarks that can be selected from the command line instead of an algorithm;
+// the optional parameter is zero when it is not given
+static const struct {
+    const char *name;
+    bench_fn fn;
+    const char *param_desc;
+} benchmarks[] = {
+    {"batched", bench_batched, "count"},
+    {"chain", bench_chain, "count"},
+    {"complex", bench_complex, "iters"},
+    {"epilogue", bench_epilogue, "iters"},
+    {"gemm", bench_gemm, "iters"},
+    {"ooc", bench_ooc, "budget (MiB)"},
+    {"prepared", bench_prepared, "iters"},
+    {"sparsity", bench_sparsity, "iters"},
+    {"syrk", bench_syrk, "iters"},
+    {"transpose", bench_transpose, "iters"},
+};
+static const size_t num_benchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
 int main(int argc, char *argv[]) {
     int param_iters = 1;
 
-    if (argc != 2) {
-        printf("Usage: %s <n> \n", argv[0]);
+    // Opened before first_touch_matrix starts any thread
+    perf_region region;
+    perf_region_init(&region);
+
+    if (argc < 2 || argc > 4) {
+        printf("Usage: %s <n> [<algorithm> [<param>]]\n", argv[0]);
         printf("  <n> is the desired test size.\n");
+        printf("  <algorithm> is one of:");
+        for (size_t a = 0; a < num_algorithms; a++)
+            printf(" %s", algorithms[a].name);
+        printf(" (default: %s).\n", algorithms[0].name);
+        printf("  <algorithm> can also be one of these benchmarks:");
+        for (size_t b = 0; b < num_benchmarks; b++)
+            printf(" %s", benchmarks[b].name);
+        printf(".\n");
+        printf("  <param> is the optional parameter of the algorithm:");
+        for (size_t a = 0; a < num_algorithms; a++)
+            if (algorithms[a].param_desc)
+                printf(" %s (%s)", algorithms[a].param_desc, algorithms[a].name);
+        for (size_t b = 0; b < num_benchmarks; b++)
+            printf(" %s (%s)", benchmarks[b].param_desc, benchmarks[b].name);
+        printf(".\n");
+        printf("  MATMUL_VERIFY=<k> checks the result of the algorithm with k random vectors.\n");
+        printf("  MATMUL_DENSITY=<d> fills only a fraction d of the tiles of the inputs.\n");
         return 1;
     }
 
+    // Runs a benchmark instead of a single multiplication if selected
+    for (size_t b = 0; argc >= 3 && b < num_benchmarks; b++) {
+        if (!strcmp(argv[2], benchmarks[b].name)) {
+            unsigned long param_n = 0, param_value = 0;
+            sscanf(argv[1], "%lu", &param_n);
+            if (argc == 4)
+                sscanf(argv[3], "%lu", &param_value);
+            printf("- Input parameters\n");
+            printf("n\t= %lu\n", param_n);
+            printf("bench\t= %s\n", benchmarks[b].name);
+            printf("kernel\t= %s\n", gemm_kernel_get()->name);
+            return benchmarks[b].fn(param_n, param_value);
+        }
+    }
+
+    // Selects the algorithm to run
+    size_t param_algo = 0;
+    if (argc >= 3) {
+        while (param_algo < num_algorithms && strcmp(argv[2], algorithms[param_algo].name))
+            param_algo++;
+        if (param_algo == num_algorithms) {
+            printf("Error: unknown algorithm '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+
     // Reads the test parameters from the command line
     int param_n = 0;
     sscanf(argv[1], "%d", &param_n);
     printf("- Input parameters\n");
     printf("n\t= %i\n", param_n);
+    printf("algo\t= %s\n", algorithms[param_algo].name);
+    if (argc == 4) {
+        if (!algorithms[param_algo].set_param) {
+            printf("Error: algorithm '%s' has no parameters\n", algorithms[param_algo].name);
+            return 1;
+        }
+        unsigned long param_value = 0;
+        sscanf(argv[3], "%lu", &param_value);
+        algorithms[param_algo].set_param(param_value);
+        printf("%s\t= %lu\n", algorithms[param_algo].param_desc, param_value);
+    }
+    printf("kernel\t= %s\n", gemm_kernel_get()->name);
+#ifdef _OPENMP
+    if (algorithms[param_algo].touch)
+        printf("threads\t= %i\n", omp_get_max_threads());
+#endif
     size_t rows = param_n, cols = param_n;
 
     // Allocates input/output resources
@@ -45,35 +917,83 @@ int main(int argc, char *argv[]) {
         printf("Error: not enough memory to run the test using n = %i\n", param_n);
         return 1;
     }
+    printf("ld\t= %zu\n", matrix_of(out_mat)->ld);
+    if (matrix_of(out_mat)->flags & MATRIX_HUGE_PAGES)
+        printf("pages\t= huge\n");
 
-    // Initializes data
-    rand_matrix(in1_mat, rows, cols);
-    rand_matrix(in2_mat, rows, cols);
+    // Initializes data (the pages are first placed by the threads that use them)
+    if (algorithms[param_algo].touch) {
+        algorithms[param_algo].touch(in1_mat, rows, cols);
+        algorithms[param_algo].touch(in2_mat, rows, cols);
+        algorithms[param_algo].touch(out_mat, rows, cols);
+    }
+    const char *density = getenv("MATMUL_DENSITY");
+    if (density) {
+        printf("density\t= %g\n", atof(density));
+        rand_block_matrix(in1_mat, rows, cols, atof(density));
+        rand_block_matrix(in2_mat, rows, cols, atof(density));
+    } else {
+        rand_matrix(in1_mat, rows, cols);
+        rand_matrix(in2_mat, rows, cols);
+    }
 
     // Calls to the corresponding function to perform the computation
     printf("- Executing test...\n");
+    perf_region_begin(&region);
     double time_start = getClock();
     // ================================================
 
     for (int iters = 0; iters < param_iters; iters++) {
-        matmul(rows, cols, cols, in1_mat, in2_mat, out_mat);
+        algorithms[param_algo].fn(rows, cols, cols, in1_mat, in2_mat, out_mat);
     }
 
     // ================================================
     double time_finish = getClock();
+    perf_region_end(&region);
 
     // Prints an execution report
-    double checksum = checksum_matrix(out_mat, rows, cols);
+    double checksum = algorithms[param_algo].checksum ? algorithms[param_algo].checksum()
+                                                      : checksum_matrix(out_mat, rows, cols);
+    if (isnan(checksum)) {
+        printf("Error: not enough memory to run the test using n = %i\n", param_n);
+        perf_region_free(&region);
+        delete_matrix(in1_mat);
+        delete_matrix(in2_mat);
+        delete_matrix(out_mat);
+        return 1;
+    }
     printf("time (s)= %.6f\n", time_finish - time_start);
     printf("size\t= %i\n", param_n);
     printf("chksum\t= %.0f\n", checksum);
     if (param_iters > 1)
         printf("iters\t= %i\n", param_iters);
+    perf_region_report(&region, 2.0 * rows * cols * cols * param_iters);
+    perf_region_free(&region);
+
+    // Verifies the result in O(n^2) when requested, so that large runs do not
+    // depend on the checksum alone
+    int status = 0;
+    const char *verify = getenv("MATMUL_VERIFY");
+    if (verify && atoi(verify) > 0) {
+        const unsigned vectors = (unsigned)atoi(verify);
+        double error = 0.0;
+        time_start = getClock();
+        int passed = verify_matmul(rows, cols, cols, in1_mat, in2_mat, out_mat, vectors, &error);
+        time_finish = getClock();
+        printf("- Verification\n");
+        printf("vectors\t= %u\n", vectors);
+        printf("error\t= %.3e (of the tolerance)\n", error);
+        printf("time (s)= %.6f\n", time_finish - time_start);
+        if (!passed) {
+            printf("Error: the result does not match A * B\n");
+            status = 1;
+        }
+    }
 
     // Release allocated resources
     delete_matrix(in1_mat);
     delete_matrix(in2_mat);
     delete_matrix(out_mat);
 
-    return 0;
+    return status;
 }
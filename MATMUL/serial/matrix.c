@@ -1,39 +1,138 @@
+#include <float.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <matrix.h>
 
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define MATRIX_HAS_MMAP 1
+#endif
+
+#define BUFFER_ALIGNMENT 64
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+// Leading dimensions are multiples of a cache line but not of LD_ALIASING
+#define LD_ALIGNMENT 8
+#define LD_ALIASING 128
+
+// Sides of the blocks of Morton matrices: multiples of MORTON_ALIGNMENT and,
+// when the dimension allows it, not larger than MORTON_MAX_BLOCK so that three
+// blocks fit in the L1 cache
+#define MORTON_ALIGNMENT 8
+#define MORTON_MAX_BLOCK 48
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Pads the leading dimension to whole cache lines, avoiding large powers of two
+// that map every row to the same cache sets
+static size_t padded_ld(size_t cols) {
+    size_t ld = (cols + LD_ALIGNMENT - 1) / LD_ALIGNMENT * LD_ALIGNMENT;
+    if (ld % LD_ALIASING == 0)
+        ld += LD_ALIGNMENT;
+    return ld;
+}
+
+static int default_flags(void) {
+    const char *huge = getenv("MATMUL_HUGE_PAGES");
+    return huge && atoi(huge) ? MATRIX_HUGE_PAGES : 0;
+}
+
+// Allocates the matrix data aligned to a huge page and advises the kernel to
+// back it with transparent huge pages; returns 0 if it is not possible
+static int alloc_huge_pages(Matrix *desc, size_t bytes) {
+#ifdef MATRIX_HAS_MMAP
+    const size_t length = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    const size_t mapped = length + HUGE_PAGE_SIZE;
+    char *base = (char *)mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return 0;
+
+    // Trims the mapping so that it begins and ends at huge page boundaries
+    const size_t head = (HUGE_PAGE_SIZE - (uintptr_t)base % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    if (head)
+        munmap(base, head);
+    if (HUGE_PAGE_SIZE - head)
+        munmap(base + head + length, HUGE_PAGE_SIZE - head);
+    madvise(base + head, length, MADV_HUGEPAGE);
+
+    desc->alloc = base + head;
+    desc->bytes = length;
+    return 1;
+#else
+    (void)desc;
+    (void)bytes;
+    return 0;
+#endif
+}
+
 // Creates a new dense matrix with the specified rows and columns
 double **new_matrix(size_t rows, size_t cols) {
+    return new_matrix_flags(rows, cols, default_flags());
+}
+
+// Creates a new dense matrix with the specified rows, columns and MATRIX_* flags
+double **new_matrix_flags(size_t rows, size_t cols, int flags) {
     if (rows < 1 || cols < 1)
         return NULL;
 
-    // Allocate a dynamic array of doubles to store the matrix data linearized
-    size_t matBytes = cols * rows * sizeof(double);
-    double *memPtr = (double *)malloc(matBytes);
-    if (!memPtr) {
+    // Allocate the descriptor followed by the array of pointers to the rows
+    Matrix *desc = (Matrix *)calloc(1, sizeof(Matrix) + rows * sizeof(double *));
+    if (!desc)
         return NULL;
-    }
+    desc->rows = rows;
+    desc->cols = cols;
+    desc->ld = padded_ld(cols);
 
-    // Allocate an array of pointers to store the beginning of each row
-    double **mat = (double **)calloc(rows, sizeof(double *));
-    if (!mat) {
-        free(memPtr);
+    // Allocate the matrix data linearized, falling back to regular pages
+    size_t matBytes = desc->ld * rows * sizeof(double);
+    if ((flags & MATRIX_HUGE_PAGES) && alloc_huge_pages(desc, matBytes)) {
+        desc->flags = MATRIX_HUGE_PAGES;
+    } else {
+        desc->alloc = new_buffer(matBytes);
+        desc->bytes = matBytes;
+    }
+    if (!desc->alloc) {
+        free(desc);
         return NULL;
     }
+    desc->data = (double *)desc->alloc;
 
     // Set the row pointers (eg. mat[2] points to the first double of row 3)
     for (size_t i = 0; i < rows; i++)
-        mat[i] = memPtr + i * cols;
+        desc->row[i] = desc->data + i * desc->ld;
 
-    return mat;
+    return desc->row;
 }
 
 // Deletes the matrix and the resources allocated by it
 void delete_matrix(double **mat) {
-    if (mat) {
-        free(mat[0]);
-        free(mat);
+    Matrix *desc = matrix_of(mat);
+    if (desc) {
+#ifdef MATRIX_HAS_MMAP
+        if (desc->flags & MATRIX_HUGE_PAGES)
+            munmap(desc->alloc, desc->bytes);
+        else
+#endif
+            delete_buffer(desc->alloc);
+        free(desc);
     }
 }
 
+Matrix *matrix_of(double **mat) {
+    if (!mat)
+        return NULL;
+    return (Matrix *)((char *)mat - offsetof(Matrix, row));
+}
+
+size_t matrix_ld(double **mat, size_t rows, size_t cols) {
+    return rows > 1 ? (size_t)(mat[1] - mat[0]) : cols;
+}
+
 // Generates a random dense matrix
 double **rand_matrix(double **mat, size_t rows, size_t cols) {
     if (!mat)
@@ -56,3 +155,332 @@ double checksum_matrix(double **mat, size_t rows, size_t cols) {
             checkSum += mat[row][col];
     return checkSum;
 }
+
+// Splits a dimension into 2^levels blocks of the returned size, using the
+// fewest levels that keep the blocks within MORTON_MAX_BLOCK
+static size_t morton_blocking(size_t dim, unsigned *levels) {
+    *levels = 0;
+    for (;;) {
+        const size_t blocks = (size_t)1 << *levels;
+        const size_t block = ((dim + blocks - 1) / blocks + MORTON_ALIGNMENT - 1) /
+                             MORTON_ALIGNMENT * MORTON_ALIGNMENT;
+        if (block <= MORTON_MAX_BLOCK)
+            return block;
+        (*levels)++;
+    }
+}
+
+// Position of block (bi, bj) in the Morton order: the bits of both indexes
+// are interleaved from the most significant one, following the halving of the
+// grid along its longest side
+static size_t morton_index(size_t bi, size_t bj, unsigned levels_rows, unsigned levels_cols) {
+    size_t index = 0;
+    while (levels_rows || levels_cols) {
+        if (levels_rows >= levels_cols) {
+            levels_rows--;
+            index = index << 1 | (bi >> levels_rows & 1);
+        } else {
+            levels_cols--;
+            index = index << 1 | (bj >> levels_cols & 1);
+        }
+    }
+    return index;
+}
+
+// Creates a new matrix stored in Morton order
+MortonMatrix *new_morton(size_t rows, size_t cols) {
+    if (rows < 1 || cols < 1)
+        return NULL;
+
+    MortonMatrix *mat = (MortonMatrix *)calloc(1, sizeof(MortonMatrix));
+    if (!mat)
+        return NULL;
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->block_rows = morton_blocking(rows, &mat->levels_rows);
+    mat->block_cols = morton_blocking(cols, &mat->levels_cols);
+
+    const size_t blocks = (size_t)1 << (mat->levels_rows + mat->levels_cols);
+    mat->data = (double *)new_buffer(blocks * mat->block_rows * mat->block_cols * sizeof(double));
+    if (!mat->data) {
+        free(mat);
+        return NULL;
+    }
+    return mat;
+}
+
+void delete_morton(MortonMatrix *mat) {
+    if (mat) {
+        delete_buffer(mat->data);
+        free(mat);
+    }
+}
+
+double *morton_block(const MortonMatrix *mat, size_t bi, size_t bj) {
+    const size_t index = morton_index(bi, bj, mat->levels_rows, mat->levels_cols);
+    return &mat->data[index * mat->block_rows * mat->block_cols];
+}
+
+// Copies the matrix block by block: each block is written sequentially from
+// block_rows row segments of the source
+void to_morton(double **src, MortonMatrix *dst) {
+    const size_t br = dst->block_rows, bc = dst->block_cols;
+    for (size_t i0 = 0; i0 < dst->rows; i0 += br) {
+        const size_t rows = MIN(br, dst->rows - i0);
+        for (size_t j0 = 0; j0 < dst->cols; j0 += bc) {
+            const size_t cols = MIN(bc, dst->cols - j0);
+            double *block = morton_block(dst, i0 / br, j0 / bc);
+            for (size_t i = 0; i < rows; i++)
+                memcpy(&block[i * bc], &src[i0 + i][j0], cols * sizeof(double));
+        }
+    }
+}
+
+void from_morton(const MortonMatrix *src, double **dst) {
+    const size_t br = src->block_rows, bc = src->block_cols;
+    for (size_t i0 = 0; i0 < src->rows; i0 += br) {
+        const size_t rows = MIN(br, src->rows - i0);
+        for (size_t j0 = 0; j0 < src->cols; j0 += bc) {
+            const size_t cols = MIN(bc, src->cols - j0);
+            const double *block = morton_block(src, i0 / br, j0 / bc);
+            for (size_t i = 0; i < rows; i++)
+                memcpy(&dst[i0 + i][j0], &block[i * bc], cols * sizeof(double));
+        }
+    }
+}
+
+// Rounding errors of C and of the verification products are tolerated up to
+// VERIFY_TOLERANCE * p * eps relative to |A| |B| |x| + |C| |x|
+#define VERIFY_TOLERANCE 16.0
+
+// xorshift64* generator, independent from rand() so that verifying a result
+// does not change the data of later tests
+static uint64_t verify_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dull;
+}
+
+// The k vectors are processed together (stored interleaved: x[j * k + v]) so
+// that each matrix is read only once
+int verify_matmul(size_t m, size_t n, size_t p, double **A, double **B, double **C,
+                  unsigned k, double *error) {
+    double *x = (double *)malloc(n * k * sizeof(double));
+    double *bx = (double *)malloc(p * k * sizeof(double));
+    double *bound_bx = (double *)malloc(p * sizeof(double));
+    double *abx = (double *)malloc(k * sizeof(double));
+    double *cx = (double *)malloc(k * sizeof(double));
+    if (!x || !bx || !bound_bx || !abx || !cx) {
+        free(x);
+        free(bx);
+        free(bound_bx);
+        free(abx);
+        free(cx);
+        if (error)
+            *error = DBL_MAX;
+        return 0;
+    }
+
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t e = 0; e < n * k; e++)
+        x[e] = verify_random(&state) >> 63 ? 1.0 : -1.0;
+
+    // B x, and its bound |B| |x|, which does not depend on x since |x| = 1
+    for (size_t i = 0; i < p; i++) {
+        double bound = 0.0;
+        for (unsigned v = 0; v < k; v++)
+            bx[i * k + v] = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            const double b = B[i][j];
+            for (unsigned v = 0; v < k; v++)
+                bx[i * k + v] += b * x[j * k + v];
+            bound += b < 0 ? -b : b;
+        }
+        bound_bx[i] = bound;
+    }
+
+    // Compares each row of A (B x) with the same row of C x
+    const double tolerance = VERIFY_TOLERANCE * (p + 1) * DBL_EPSILON;
+    double max_error = 0.0;
+    for (size_t i = 0; i < m; i++) {
+        double bound = 0.0;
+        for (unsigned v = 0; v < k; v++)
+            abx[v] = cx[v] = 0.0;
+        for (size_t l = 0; l < p; l++) {
+            const double a = A[i][l];
+            for (unsigned v = 0; v < k; v++)
+                abx[v] += a * bx[l * k + v];
+            bound += (a < 0 ? -a : a) * bound_bx[l];
+        }
+        for (size_t j = 0; j < n; j++) {
+            const double c = C[i][j];
+            for (unsigned v = 0; v < k; v++)
+                cx[v] += c * x[j * k + v];
+            bound += c < 0 ? -c : c;
+        }
+
+        const double limit = tolerance * bound;
+        for (unsigned v = 0; v < k; v++) {
+            const double diff = abx[v] > cx[v] ? abx[v] - cx[v] : cx[v] - abx[v];
+            const double row_error = limit > 0.0 ? diff / limit : diff > 0.0 ? DBL_MAX : 0.0;
+            if (row_error > max_error)
+                max_error = row_error;
+        }
+    }
+
+    free(x);
+    free(bx);
+    free(bound_bx);
+    free(abx);
+    free(cx);
+    if (error)
+        *error = max_error;
+    return max_error <= 1.0;
+}
+
+// Returns non-zero if the rows x cols tile of src that begins at (i0, j0) has
+// any nonzero element
+static int tile_nonzero(double **src, size_t i0, size_t j0, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            if (src[i0 + i][j0 + j] != 0.0)
+                return 1;
+    return 0;
+}
+
+// The bitmap is filled in a first pass, so that the nonzero tiles can then be
+// copied to a single allocation of the right size
+BlockSparseMatrix *new_block_sparse(double **src, size_t rows, size_t cols) {
+    const size_t bs = BLOCK_SPARSE_TILE;
+    BlockSparseMatrix *mat = (BlockSparseMatrix *)calloc(1, sizeof(BlockSparseMatrix));
+    if (!mat)
+        return NULL;
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->tile_rows = (rows + bs - 1) / bs;
+    mat->tile_cols = (cols + bs - 1) / bs;
+    mat->words = (mat->tile_cols + 63) / 64;
+    // At least one word, so that an empty matrix is not an allocation failure
+    mat->bitmap = (uint64_t *)calloc(mat->tile_rows * mat->words + 1, sizeof(uint64_t));
+    mat->row_start = (size_t *)malloc((mat->tile_rows + 1) * sizeof(size_t));
+    if (!mat->bitmap || !mat->row_start) {
+        delete_block_sparse(mat);
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (size_t bi = 0; bi < mat->tile_rows; bi++) {
+        const size_t i0 = bi * bs;
+        mat->row_start[bi] = count;
+        for (size_t bj = 0; bj < mat->tile_cols; bj++) {
+            const size_t j0 = bj * bs;
+            if (tile_nonzero(src, i0, j0, MIN(bs, rows - i0), MIN(bs, cols - j0))) {
+                mat->bitmap[bi * mat->words + bj / 64] |= (uint64_t)1 << (bj % 64);
+                count++;
+            }
+        }
+    }
+    mat->row_start[mat->tile_rows] = count;
+
+    // An all-zero matrix stores no tiles
+    if (count == 0)
+        return mat;
+    mat->tiles = (double *)new_buffer(count * bs * bs * sizeof(double));
+    if (!mat->tiles) {
+        delete_block_sparse(mat);
+        return NULL;
+    }
+
+    double *tile = mat->tiles;
+    for (size_t bi = 0; bi < mat->tile_rows; bi++) {
+        const size_t i0 = bi * bs, tile_rows = MIN(bs, rows - i0);
+        for (size_t bj = 0; bj < mat->tile_cols; bj++) {
+            if (!block_sparse_test(mat, bi, bj))
+                continue;
+            const size_t j0 = bj * bs, tile_cols = MIN(bs, cols - j0);
+            if (tile_rows < bs || tile_cols < bs)
+                memset(tile, 0, bs * bs * sizeof(double));
+            for (size_t i = 0; i < tile_rows; i++)
+                memcpy(&tile[i * bs], &src[i0 + i][j0], tile_cols * sizeof(double));
+            tile += bs * bs;
+        }
+    }
+    return mat;
+}
+
+void delete_block_sparse(BlockSparseMatrix *mat) {
+    if (mat) {
+        delete_buffer(mat->tiles);
+        free(mat->row_start);
+        free(mat->bitmap);
+        free(mat);
+    }
+}
+
+int block_sparse_test(const BlockSparseMatrix *mat, size_t bi, size_t bj) {
+    return (mat->bitmap[bi * mat->words + bj / 64] >> (bj % 64)) & 1;
+}
+
+void from_block_sparse(const BlockSparseMatrix *src, double **dst) {
+    const size_t bs = BLOCK_SPARSE_TILE;
+    const double *tile = src->tiles;
+    for (size_t bi = 0; bi < src->tile_rows; bi++) {
+        const size_t i0 = bi * bs, tile_rows = MIN(bs, src->rows - i0);
+        for (size_t bj = 0; bj < src->tile_cols; bj++) {
+            const size_t j0 = bj * bs, tile_cols = MIN(bs, src->cols - j0);
+            if (block_sparse_test(src, bi, bj)) {
+                for (size_t i = 0; i < tile_rows; i++)
+                    memcpy(&dst[i0 + i][j0], &tile[i * bs], tile_cols * sizeof(double));
+                tile += bs * bs;
+            } else {
+                for (size_t i = 0; i < tile_rows; i++)
+                    memset(&dst[i0 + i][j0], 0, tile_cols * sizeof(double));
+            }
+        }
+    }
+}
+
+// The tiles are drawn in the order of the grid, so the same seed always gives
+// the same matrix
+double **rand_block_matrix(double **mat, size_t rows, size_t cols, double density) {
+    if (!mat)
+        return NULL;
+
+    const size_t bs = BLOCK_SPARSE_TILE;
+    for (size_t i0 = 0; i0 < rows; i0 += bs) {
+        const size_t tile_rows = MIN(bs, rows - i0);
+        for (size_t j0 = 0; j0 < cols; j0 += bs) {
+            const size_t tile_cols = MIN(bs, cols - j0);
+            const int filled = rand() < density * ((double)RAND_MAX + 1.0);
+            for (size_t i = 0; i < tile_rows; i++)
+                for (size_t j = 0; j < tile_cols; j++)
+                    mat[i0 + i][j0 + j] = filled ? rand() % 10 : 0.0;
+        }
+    }
+    return mat;
+}
+
+// Allocates a scratch buffer aligned to a cache line
+void *new_buffer(size_t bytes) {
+    if (bytes < 1)
+        return NULL;
+
+#ifdef _WIN32
+    return _aligned_malloc(bytes, BUFFER_ALIGNMENT);
+#else
+    void *buf = NULL;
+    if (posix_memalign(&buf, BUFFER_ALIGNMENT, bytes))
+        return NULL;
+    return buf;
+#endif
+}
+
+// Deletes a buffer allocated with new_buffer()
+void delete_buffer(void *buf) {
+#ifdef _WIN32
+    _aligned_free(buf);
+#else
+    free(buf);
+#endif
+}
@@ -43,6 +43,7 @@
 #include "randdp.h"
 #include "timers.h"
 #include "print_results.h"
+#include "perf_counters.h"
 
 
 //---------------------------------------------------------------------
@@ -134,9 +135,13 @@ int main(int argc, char *argv[])
   char Class;
   logical verified;
   double zeta_verify_value, epsilon, err;
+  perf_region region;
 
   char *t_names[T_last];
 
+  // Opened before the warm-up iteration starts any thread
+  perf_region_init(&region);
+
   for (i = 0; i < T_last; i++) {
     timer_clear(i);
   }
@@ -286,6 +291,7 @@ int main(int argc, char *argv[])
 
   printf(" Initialization time = %15.3f seconds\n", timer_read(T_init));
 
+  perf_region_begin(&region);
   timer_start(T_bench);
 
   //---------------------------------------------------------------------
@@ -330,6 +336,7 @@ int main(int argc, char *argv[])
   } // end of main iter inv pow meth
 
   timer_stop(T_bench);
+  perf_region_end(&region);
 
   //---------------------------------------------------------------------
   // End of timed section
@@ -374,6 +381,9 @@ int main(int argc, char *argv[])
                 verified, NPBVERSION, COMPILETIME,
                 CS1, CS2, CS3, CS4, CS5, CS6, CS7);
 
+  perf_region_report(&region, mflops * 1.0e6 * t);
+  perf_region_free(&region);
+
   //---------------------------------------------------------------------
   // More timers
   //---------------------------------------------------------------------
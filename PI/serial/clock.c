@@ -0,0 +1,14 @@
+#include <clock.h>
+
+double getClock() {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#elif __linux__ || __APPLE__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+#else
+    // Warning: this clock is invalid for parallel applications
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
@@ -0,0 +1,7 @@
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+double getClock();
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _PI_KERNELS_H_
+#define _PI_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*   Vectorized kernels for the midpoint rule of PI
+
+       pi = 4 * integral of sqrt(1 - x^2) over [0, 1] ~ 4 / N * sum f((i + 0.5) / N)
+
+     The reference loop adds every term to a single accumulator, so each step
+     waits for the previous addition, and converts i to a double every time.
+     The kernels below keep several vector accumulators, generate the abscissas
+     by adding a constant to a vector of half-integers (which stays exact up to
+     2^52) and compute the square roots with vector instructions. Other offsets
+     than 1/2 give the shifted grids used to refine the midpoint rule. The best
+     kernel for the running CPU is selected at runtime.
+
+     Each kernel also has a Monte Carlo counterpart, which counts the random
+     points of the unit square that fall inside the quarter circle:
+
+       pi ~ 4 * hits / samples
+
+     The points come from Philox4x32-10 (see philox.h): block i of the stream
+     is the counter (i mod 2^32, i / 2^32, 0, 0), whose four words are the
+     coordinates of two points with 32-bit precision. Each SIMD lane computes
+     its own blocks, and the test x^2 + y^2 < 1 is done on the integer
+     coordinates, so every kernel and any number of threads count exactly the
+     same hits for a given seed.
+*/
+
+// Sum of sqrt(1 - x^2) for x = (i + offset) * h and i in [begin, end)
+typedef double (*pi_sum_fn)(unsigned long begin, unsigned long end, double offset, double h);
+
+// Number of points inside the quarter circle among those of the blocks in
+// [begin, end) of the random stream selected by key
+typedef unsigned long (*pi_hits_fn)(unsigned long begin, unsigned long end, const uint32_t key[2]);
+
+typedef struct pi_kernel {
+    const char *name;
+    size_t lanes;  // Terms computed per iteration of the main loop
+    pi_sum_fn fn;
+    pi_hits_fn hits;
+} pi_kernel;
+
+// Returns the best kernel for the running CPU; the choice is made on the first
+// call and can be overridden through the PI_KERNEL environment variable
+const pi_kernel *pi_kernel_get(void);
+
+// Returns the kernel with the selected name, or NULL if it is not supported
+const pi_kernel *pi_kernel_find(const char *name);
+
+// Approximation of pi with N steps and the selected kernel on a single thread;
+// evals receives the number of evaluations of the integrand (N)
+double pi_simd(unsigned long N, unsigned long *evals);
+
+// Same with all the OpenMP threads. The steps are split into chunks that only
+// depend on N, and their sums are added in a fixed pairwise tree, so the result
+// is bit-identical for any number of threads
+double pi_parallel(unsigned long N, unsigned long *evals);
+
+// Monte Carlo approximation of pi with N random points from the stream of the
+// selected seed, with all the OpenMP threads (the result only depends on N and
+// the seed)
+double pi_montecarlo(unsigned long N, uint64_t seed, unsigned long *evals);
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef _PROCESSES_H_
+#define _PROCESSES_H_
+
+/*   Range decomposition of PI across forked processes
+
+     A stand-in for a multi-node run on a single host: the steps [0, N) are
+     split into contiguous ranges, one per worker process, and each worker is
+     pinned to its own CPU before computing its range with the vectorized
+     kernel. The workers share nothing but a page mapped before the fork, where
+     each one writes its partial sum and its time to its own cache line. The
+     parent adds the slots in worker order, so the result only depends on N and
+     on the number of workers.
+
+     CPUs are taken in order from those the process may run on (placement
+     "cores"), or alternating between sockets ("sockets") to spread the memory
+     traffic over all of them. With more workers than CPUs, some of them share
+     a CPU (with a warning). Without fork() (or if it fails) the ranges are
+     computed by the calling process itself.
+*/
+
+enum { PLACE_CORES, PLACE_SOCKETS };
+
+// Report of each worker
+typedef struct pi_worker {
+    int cpu;                   // CPU the worker ran on (-1 if unknown)
+    int package;               // Socket of that CPU (-1 if unknown)
+    unsigned long begin, end;  // Range of steps
+    double sum;                // Partial sum of the range
+    double time;               // Seconds spent computing it
+} pi_worker;
+
+// Number of CPUs the process may run on
+int pi_available_cpus(void);
+
+// Approximation of pi with N steps split among count workers, placed as
+// selected; workers (count elements) receives their reports. Returns NaN if a
+// worker failed
+double pi_processes(unsigned long N, int count, int placement, pi_worker *workers,
+                    unsigned long *evals);
+
+#endif
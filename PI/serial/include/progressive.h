@@ -0,0 +1,41 @@
+#pragma once
+#ifndef _PROGRESSIVE_H_
+#define _PROGRESSIVE_H_
+
+/*   Progressive refinement of PI under a time budget
+
+     Instead of rerunning with a larger number of steps, the grid is refined
+     level by level and every level keeps the sums of the previous ones, so it
+     only evaluates the new points:
+
+       midpoint: trisecting each cell keeps its midpoint as the midpoint of the
+                 central third, so 3N cells cost 2N new evaluations
+       romberg:  halving the step of the trapezoidal rule costs one evaluation
+                 per interval, and the table extrapolates all the levels
+
+     A new level is only started when the time it is expected to take (from
+     the previous one) fits in what remains of the budget, so the result is the
+     best estimate that the budget allows. After each level, report (if not
+     NULL) receives the current estimate.
+*/
+
+typedef struct pi_progress {
+    int level;
+    unsigned long points;  // Points of the grid of this level
+    unsigned long evals;   // Evaluations of the integrand so far
+    double estimate;       // Approximation of pi
+    double time;           // Seconds since the start
+} pi_progress;
+
+typedef void (*pi_progress_fn)(const pi_progress *progress, void *data);
+
+// Midpoint rule with the vectorized kernel, from 1 to 3^level cells
+double pi_progressive_midpoint(double budget, pi_progress_fn report, void *data,
+                               unsigned long *evals);
+
+// Romberg extrapolation (see quadrature.h), which stops early when the
+// estimate no longer changes
+double pi_progressive_romberg(double budget, pi_progress_fn report, void *data,
+                              unsigned long *evals);
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef _QUADRATURE_H_
+#define _QUADRATURE_H_
+
+#include <integrate.h>
+
+/*   Higher-order quadrature rules for PI
+
+     The integrand of the midpoint loop, sqrt(1 - x^2), has an infinite
+     derivative at x = 1, which limits every rule on uniform steps to an error
+     of O(h^1.5): a higher order alone does not help. With x = 1 - u^2 the
+     integral becomes
+
+       pi / 4 = integral of 2 u^2 sqrt(2 - u^2) over [0, 1]
+
+     whose integrand is analytic on [0, 1], so the rules below reach their
+     nominal order and need orders of magnitude fewer evaluations for the same
+     error. Each function returns the approximation of pi and stores the number
+     of evaluations of the integrand in evals.
+*/
+
+// Panels of each integral of the batched methods
+#define BATCH_PANELS 2
+
+// Instance of integrate.h for the integrand above
+INTEGRATE_DECLARE(quarter_circle);
+
+// Composite Simpson rule with n intervals (rounded up to an even number)
+double pi_simpson(unsigned long n, unsigned long *evals);
+
+// Gauss-Legendre rule with INTEGRATE_POINTS points on each of n panels
+double pi_gauss(unsigned long n, unsigned long *evals);
+
+// Sum of count integrals over consecutive sub-intervals of [0, 1], computed in
+// a single parallel pass by integrate_quarter_circle_batch()
+double pi_batch(unsigned long count, unsigned long *evals);
+
+// Same with one call to integrate_quarter_circle_parallel() per integral, which
+// starts the threads every time
+double pi_batch_calls(unsigned long count, unsigned long *evals);
+
+// Romberg extrapolation of the trapezoidal rule up to n intervals (rounded up
+// to a power of two)
+double pi_romberg(unsigned long n, unsigned long *evals);
+
+/*   Romberg table refined one level at a time
+
+     Each level halves the step of the trapezoidal rule, evaluating only the
+     new midpoints, and removes one more term of its error expansion:
+
+       R(k, 0) = T(1 / 2^k)
+       R(k, j) = R(k, j - 1) + (R(k, j - 1) - R(k - 1, j - 1)) / (4^j - 1)
+
+     Only the last row of the table is kept.
+*/
+
+// Levels beyond the precision of the step sizes are never needed
+#define ROMBERG_MAX_LEVELS 48
+
+typedef struct romberg_table {
+    int level;                       // Last level (2^level intervals)
+    unsigned long evals;             // Evaluations of the integrand so far
+    double row[ROMBERG_MAX_LEVELS];  // R(level, 0..level)
+} romberg_table;
+
+void romberg_init(romberg_table *table);
+
+// Adds a level to the table; returns zero if it is full
+int romberg_refine(romberg_table *table);
+
+// Best approximation of pi in the table, 4 R(level, level)
+double romberg_pi(const romberg_table *table);
+
+// Adaptive Simpson rule that splits the intervals until the estimated error of
+// the result is below tol
+double pi_adaptive(double tol, unsigned long *evals);
+
+#endif
@@ -1,61 +1,213 @@
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include <clock.h>
+#include <perf_counters.h>
+#include <pi_kernels.h>
+#include <processes.h>
+#include <progressive.h>
+#include <quadrature.h>
+
+static const double realPiValue = 3.141592653589793238;
+
+// Reference version: midpoint rule with a single accumulator
+double pi_loop(unsigned long N, unsigned long *evals) {
+    *evals = N;
+    double sum = 0.0;
+    for (unsigned long i = 0; i < N; i++) {
+        double x = (i + 0.5) / N;
+        sum += sqrt(1 - x * x);
+    }
+
+    return 4.0 / N * sum;
+}
+
+// Streams the estimates of the progressive methods as they are refined
+static void print_progress(const pi_progress *progress, void *data) {
+    (void)data;
+    printf("level %2d: t = %.6f s, points = %lu, evals = %lu, result = %.15f, error = %.1e\n",
+           progress->level, progress->time, progress->points, progress->evals, progress->estimate,
+           fabs(progress->estimate - realPiValue));
+    fflush(stdout);
+}
+
+static double progressive_midpoint(double budget, unsigned long *evals) {
+    return pi_progressive_midpoint(budget, print_progress, NULL, evals);
+}
+
+static double progressive_romberg(double budget, unsigned long *evals) {
+    return pi_progressive_romberg(budget, print_progress, NULL, evals);
+}
+
+// Seed of the random stream of the Monte Carlo method (PI_SEED)
+static uint64_t param_seed = 0;
+
+static double montecarlo(unsigned long N, unsigned long *evals) {
+    return pi_montecarlo(N, param_seed, evals);
+}
+
+// Worker processes of the processes method (PI_WORKERS, PI_PLACE)
+static int param_workers = 1;
+static int param_place = PLACE_CORES;
+
+static double processes(unsigned long N, unsigned long *evals) {
+    pi_worker *workers = (pi_worker *)malloc(param_workers * sizeof(pi_worker));
+    if (!workers) {
+        printf("Error: not enough memory for %d workers\n", param_workers);
+        *evals = 0;
+        return NAN;
+    }
+    const double result = pi_processes(N, param_workers, param_place, workers, evals);
+
+    // The imbalance is the time of the slowest worker over the mean time
+    printf("- Workers\n");
+    double slowest = 0.0, total = 0.0;
+    for (int w = 0; w < param_workers; w++) {
+        printf("worker %d: cpu = %d, socket = %d, steps = %lu, time (s) = %.6f\n", w,
+               workers[w].cpu, workers[w].package, workers[w].end - workers[w].begin,
+               workers[w].time);
+        total += workers[w].time;
+        if (workers[w].time > slowest)
+            slowest = workers[w].time;
+    }
+    const double mean = total / param_workers;
+    printf("imbal\t= %.1f%%\n", mean > 0.0 ? 100.0 * (slowest / mean - 1.0) : 0.0);
+    free(workers);
+    return result;
+}
+
+// Meaning of the first argument: a number of steps, or a real number for the
+// methods that take a target error or a time budget instead
+enum { PARAM_STEPS, PARAM_TOL, PARAM_BUDGET };
+static const char *param_names[] = {"steps", "tol", "budget"};
+static const char *param_descs[] = {NULL, "the target error (e.g. 1e-12)", "the time budget in seconds"};
 
-double getClock();
+// Methods that can be selected from the command line, whether they use the
+// vectorized kernels and the OpenMP threads, and the floating-point operations
+// of each evaluation: about 6 for the integrand, counting the square root as
+// one, and none for the integer hit test of the Monte Carlo samples
+static const struct {
+    const char *name;
+    double (*fn)(unsigned long N, unsigned long *evals);
+    double (*fn_real)(double param, unsigned long *evals);
+    int param;
+    int kernel, threads;
+    double flops;
+} methods[] = {
+    {"loop", pi_loop, NULL, PARAM_STEPS, 0, 0, 6.0},
+    {"simd", pi_simd, NULL, PARAM_STEPS, 1, 0, 6.0},
+    {"parallel", pi_parallel, NULL, PARAM_STEPS, 1, 1, 6.0},
+    {"simpson", pi_simpson, NULL, PARAM_STEPS, 0, 0, 6.0},
+    {"gauss", pi_gauss, NULL, PARAM_STEPS, 0, 0, 6.0},
+    {"romberg", pi_romberg, NULL, PARAM_STEPS, 0, 0, 6.0},
+    {"batch", pi_batch, NULL, PARAM_STEPS, 0, 1, 6.0},
+    {"batch-calls", pi_batch_calls, NULL, PARAM_STEPS, 0, 1, 6.0},
+    {"montecarlo", montecarlo, NULL, PARAM_STEPS, 1, 1, 0.0},
+    {"processes", processes, NULL, PARAM_STEPS, 1, 0, 6.0},
+    {"adaptive", NULL, pi_adaptive, PARAM_TOL, 0, 0, 6.0},
+    {"progressive", NULL, progressive_midpoint, PARAM_BUDGET, 1, 0, 6.0},
+    {"progressive-romberg", NULL, progressive_romberg, PARAM_BUDGET, 0, 0, 6.0},
+};
+static const size_t num_methods = sizeof(methods) / sizeof(methods[0]);
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <steps>\n", argv[0]);
+    perf_region region;
+    perf_region_init(&region);
+
+    if (argc < 2 || argc > 3) {
+        printf("Usage: %s <steps> [<method>]\n", argv[0]);
         printf("  <steps> controls the precision of the approximation.\n");
+        for (int p = PARAM_TOL; p <= PARAM_BUDGET; p++) {
+            printf("  It is %s for:", param_descs[p]);
+            for (size_t m = 0; m < num_methods; m++)
+                if (methods[m].param == p)
+                    printf(" %s", methods[m].name);
+            printf(".\n");
+        }
+        printf("  <method> is one of:");
+        for (size_t m = 0; m < num_methods; m++)
+            printf(" %s", methods[m].name);
+        printf(" (default: %s).\n", methods[0].name);
+        printf("  PI_KERNEL=<name> selects the vectorized kernel (avx512, avx2, sse2, generic).\n");
+        printf("  PI_SEED=<seed> selects the random stream of montecarlo (default: 0).\n");
+        printf("  PI_WORKERS=<n> sets the worker processes of processes (default: one per CPU).\n");
+        printf("  PI_PLACE=cores|sockets fills the cores in order or alternates the sockets.\n");
         return 0;
     }
 
+    // Selects the method to run
+    size_t method = 0;
+    if (argc == 3) {
+        while (method < num_methods && strcmp(argv[2], methods[method].name))
+            method++;
+        if (method == num_methods) {
+            printf("Error: unknown method '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+
     // Reads the test parameters from the command line
-    unsigned long N = atol(argv[1]);
+    unsigned long N = 0;
+    double param_real = 0.0;
     printf("- Input parameters\n");
-    printf("steps\t= %lu\n", N);
+    if (methods[method].fn_real) {
+        param_real = atof(argv[1]);
+        printf("%s\t= %g\n", param_names[methods[method].param], param_real);
+    } else {
+        N = atol(argv[1]);
+        printf("steps\t= %lu\n", N);
+    }
+    printf("method\t= %s\n", methods[method].name);
+    if (methods[method].fn == montecarlo) {
+        const char *seed = getenv("PI_SEED");
+        if (seed)
+            param_seed = strtoull(seed, NULL, 0);
+        printf("seed\t= %llu\n", (unsigned long long)param_seed);
+    }
+    if (methods[method].fn == processes) {
+        const char *workers = getenv("PI_WORKERS"), *place = getenv("PI_PLACE");
+        param_workers = workers && atoi(workers) > 0 ? atoi(workers) : pi_available_cpus();
+        param_place = place && !strcmp(place, "sockets") ? PLACE_SOCKETS : PLACE_CORES;
+        printf("workers\t= %d\n", param_workers);
+        printf("place\t= %s\n", param_place == PLACE_SOCKETS ? "sockets" : "cores");
+    }
+    if (methods[method].kernel)
+        printf("kernel\t= %s\n", pi_kernel_get()->name);
+#ifdef _OPENMP
+    if (methods[method].threads)
+        printf("threads\t= %i\n", omp_get_max_threads());
+#endif
 
     printf("- Executing test...\n");
+    perf_region_begin(&region);
     double time_start = getClock();
     // ================================================
 
-    double out_result;
-
-    double sum = 0.0;
-    for (unsigned long i = 0; i < N; i++) {
-        double x = (i + 0.5) / N;
-        sum += sqrt(1 - x * x);
-    }
-
-    out_result = 4.0 / N * sum;
+    unsigned long evals = 0;
+    double out_result = methods[method].fn_real ? methods[method].fn_real(param_real, &evals)
+                                                : methods[method].fn(N, &evals);
 
     // ================================================
     double time_finish = getClock();
+    perf_region_end(&region);
 
     // Prints an execution report
     printf("time (s)= %.6f\n", time_finish - time_start);
     printf("result\t= %.8f\n", out_result);
-    const double realPiValue = 3.141592653589793238;
-    printf("error\t= %.1e\n", fabs(out_result - realPiValue));
-
-    return 0;
-}
-
-double getClock() {
+    const double error = fabs(out_result - realPiValue);
+    printf("error\t= %.1e\n", error);
+    printf("evals\t= %lu\n", evals);
+    printf("evals/s\t= %.3e\n", evals / (time_finish - time_start));
 #ifdef _OPENMP
-    return omp_get_wtime();
-#elif __linux__ || __APPLE__
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec + ts.tv_nsec / 1.0e9;
-#else
-    // Warning: this clock is invalid for parallel applications
-    return (double)clock() / CLOCKS_PER_SEC;
+    if (methods[method].threads)
+        printf("ev/s/thr= %.3e\n", evals / (time_finish - time_start) / omp_get_max_threads());
 #endif
+    printf("err/ev\t= %.1e\n", evals ? error / evals : error);
+    perf_region_report(&region, methods[method].flops * evals);
+    perf_region_free(&region);
+
+    return 0;
 }
@@ -0,0 +1,444 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpu_features.h>
+#include <philox.h>
+#include <pi_kernels.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PI_X86 1
+#include <immintrin.h>
+#endif
+
+// Chunks of the parallel version: at least PI_CHUNK steps each and no more than
+// PI_MAX_CHUNKS of them, so that the partial sums stay small for any N
+#define PI_CHUNK (1ul << 16)
+#define PI_MAX_CHUNKS (1ul << 16)
+
+// Blocks of the random stream (two points each) per chunk of pi_montecarlo()
+#define PI_MC_CHUNK (1ul << 16)
+
+// Terms left over by the main loop of a kernel
+static double sum_tail(unsigned long begin, unsigned long end, double offset, double h) {
+    double sum = 0.0;
+    double xi = begin + offset;
+    for (unsigned long i = begin; i < end; i++) {
+        double x = xi * h;
+        sum += sqrt(1.0 - x * x);
+        xi += 1.0;
+    }
+    return sum;
+}
+
+// Portable kernel: 4 scalar accumulators
+static double sum_generic(unsigned long begin, unsigned long end, double offset, double h) {
+    const unsigned long blocks = (end - begin) / 4;
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    double xi = begin + offset;
+
+    for (unsigned long b = 0; b < blocks; b++) {
+        for (int l = 0; l < 4; l++) {
+            double x = (xi + l) * h;
+            acc[l] += sqrt(1.0 - x * x);
+        }
+        xi += 4.0;
+    }
+
+    return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + sum_tail(begin + blocks * 4, end, offset, h);
+}
+
+/*   Monte Carlo kernels
+
+     A point (X, Y) / 2^32 is outside the quarter circle when X^2 + Y^2 >= 2^64,
+     which is tested without overflow on the halves of the squares:
+
+       (X^2 >> 1) + (Y^2 >> 1) + (X^2 & Y^2 & 1) >= 2^63
+
+     so that the outcome is the top bit of a 64-bit sum. The vector kernels keep
+     each 32-bit word in the low half of a 64-bit lane, as needed by the 32 x 32
+     -> 64 bit multiplication; the high halves of the words are never used, so
+     they are not cleared.
+*/
+
+// Returns 1 if the point is outside the quarter circle
+static inline unsigned outside(uint32_t x, uint32_t y) {
+    const uint64_t xx = (uint64_t)x * x, yy = (uint64_t)y * y;
+    return (unsigned)(((xx >> 1) + (yy >> 1) + (xx & yy & 1)) >> 63);
+}
+
+// Portable kernel: one block of the stream at a time
+static unsigned long hits_generic(unsigned long begin, unsigned long end, const uint32_t key[2]) {
+    unsigned long misses = 0;
+    for (unsigned long b = begin; b < end; b++) {
+        const uint32_t ctr[4] = {(uint32_t)b, (uint32_t)((uint64_t)b >> 32), 0, 0};
+        uint32_t words[4];
+        philox4x32(ctr, key, words);
+        misses += outside(words[0], words[1]) + outside(words[2], words[3]);
+    }
+    return 2 * (end - begin) - misses;
+}
+
+// Keys of each round of Philox, so that the vector kernels only broadcast them
+static void round_keys(const uint32_t key[2], uint32_t k0[PHILOX_ROUNDS], uint32_t k1[PHILOX_ROUNDS]) {
+    k0[0] = key[0];
+    k1[0] = key[1];
+    for (int r = 1; r < PHILOX_ROUNDS; r++) {
+        k0[r] = k0[r - 1] + PHILOX_W0;
+        k1[r] = k1[r - 1] + PHILOX_W1;
+    }
+}
+
+#ifdef PI_X86
+// SSE2 kernel: 4 accumulators of 2 doubles
+TARGET_SSE2 static double sum_sse2(unsigned long begin, unsigned long end, double offset, double h) {
+    const unsigned long blocks = (end - begin) / 8;
+    const __m128d vh = _mm_set1_pd(h), one = _mm_set1_pd(1.0), step = _mm_set1_pd(8.0);
+    __m128d xi0 = _mm_add_pd(_mm_set1_pd(begin + offset), _mm_setr_pd(0.0, 1.0));
+    __m128d xi1 = _mm_add_pd(xi0, _mm_set1_pd(2.0));
+    __m128d xi2 = _mm_add_pd(xi0, _mm_set1_pd(4.0));
+    __m128d xi3 = _mm_add_pd(xi0, _mm_set1_pd(6.0));
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    __m128d acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+
+    for (unsigned long b = 0; b < blocks; b++) {
+        __m128d x0 = _mm_mul_pd(xi0, vh), x1 = _mm_mul_pd(xi1, vh);
+        __m128d x2 = _mm_mul_pd(xi2, vh), x3 = _mm_mul_pd(xi3, vh);
+        acc0 = _mm_add_pd(acc0, _mm_sqrt_pd(_mm_sub_pd(one, _mm_mul_pd(x0, x0))));
+        acc1 = _mm_add_pd(acc1, _mm_sqrt_pd(_mm_sub_pd(one, _mm_mul_pd(x1, x1))));
+        acc2 = _mm_add_pd(acc2, _mm_sqrt_pd(_mm_sub_pd(one, _mm_mul_pd(x2, x2))));
+        acc3 = _mm_add_pd(acc3, _mm_sqrt_pd(_mm_sub_pd(one, _mm_mul_pd(x3, x3))));
+        xi0 = _mm_add_pd(xi0, step);
+        xi1 = _mm_add_pd(xi1, step);
+        xi2 = _mm_add_pd(xi2, step);
+        xi3 = _mm_add_pd(xi3, step);
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3)));
+    return (lanes[0] + lanes[1]) + sum_tail(begin + blocks * 8, end, offset, h);
+}
+
+// SSE2 Monte Carlo kernel: 2 vectors of 2 blocks
+TARGET_SSE2 static inline __m128i outside_sse2(__m128i x, __m128i y) {
+    const __m128i xx = _mm_mul_epu32(x, x), yy = _mm_mul_epu32(y, y);
+    const __m128i low = _mm_and_si128(_mm_and_si128(xx, yy), _mm_set1_epi64x(1));
+    const __m128i half = _mm_add_epi64(_mm_add_epi64(_mm_srli_epi64(xx, 1), _mm_srli_epi64(yy, 1)), low);
+    return _mm_srli_epi64(half, 63);
+}
+
+TARGET_SSE2 static unsigned long hits_sse2(unsigned long begin, unsigned long end, const uint32_t key[2]) {
+    const unsigned long iters = (end - begin) / 4;
+    uint32_t k0[PHILOX_ROUNDS], k1[PHILOX_ROUNDS];
+    round_keys(key, k0, k1);
+    const __m128i m0 = _mm_set1_epi64x(PHILOX_M0), m1 = _mm_set1_epi64x(PHILOX_M1);
+    const __m128i step = _mm_set1_epi64x(4);
+    __m128i b[2] = {_mm_add_epi64(_mm_set1_epi64x(begin), _mm_set_epi64x(1, 0)),
+                    _mm_add_epi64(_mm_set1_epi64x(begin), _mm_set_epi64x(3, 2))};
+    __m128i misses = _mm_setzero_si128();
+
+    for (unsigned long i = 0; i < iters; i++) {
+        __m128i c0[2], c1[2], c2[2], c3[2];
+        for (int v = 0; v < 2; v++) {
+            c0[v] = b[v];
+            c1[v] = _mm_srli_epi64(b[v], 32);
+            c2[v] = c3[v] = _mm_setzero_si128();
+        }
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+            const __m128i rk0 = _mm_set1_epi64x(k0[r]), rk1 = _mm_set1_epi64x(k1[r]);
+            for (int v = 0; v < 2; v++) {
+                const __m128i p0 = _mm_mul_epu32(m0, c0[v]), p1 = _mm_mul_epu32(m1, c2[v]);
+                c0[v] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p1, 32), c1[v]), rk0);
+                c2[v] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p0, 32), c3[v]), rk1);
+                c1[v] = p1;
+                c3[v] = p0;
+            }
+        }
+        for (int v = 0; v < 2; v++) {
+            misses = _mm_add_epi64(misses, outside_sse2(c0[v], c1[v]));
+            misses = _mm_add_epi64(misses, outside_sse2(c2[v], c3[v]));
+            b[v] = _mm_add_epi64(b[v], step);
+        }
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, misses);
+    return 8 * iters - (lanes[0] + lanes[1]) + hits_generic(begin + iters * 4, end, key);
+}
+
+// AVX2 kernel: 4 accumulators of 4 doubles
+TARGET_AVX2 static double sum_avx2(unsigned long begin, unsigned long end, double offset, double h) {
+    const unsigned long blocks = (end - begin) / 16;
+    const __m256d vh = _mm256_set1_pd(h), one = _mm256_set1_pd(1.0), step = _mm256_set1_pd(16.0);
+    __m256d xi0 = _mm256_add_pd(_mm256_set1_pd(begin + offset), _mm256_setr_pd(0.0, 1.0, 2.0, 3.0));
+    __m256d xi1 = _mm256_add_pd(xi0, _mm256_set1_pd(4.0));
+    __m256d xi2 = _mm256_add_pd(xi0, _mm256_set1_pd(8.0));
+    __m256d xi3 = _mm256_add_pd(xi0, _mm256_set1_pd(12.0));
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+
+    for (unsigned long b = 0; b < blocks; b++) {
+        __m256d x0 = _mm256_mul_pd(xi0, vh), x1 = _mm256_mul_pd(xi1, vh);
+        __m256d x2 = _mm256_mul_pd(xi2, vh), x3 = _mm256_mul_pd(xi3, vh);
+        acc0 = _mm256_add_pd(acc0, _mm256_sqrt_pd(_mm256_fnmadd_pd(x0, x0, one)));
+        acc1 = _mm256_add_pd(acc1, _mm256_sqrt_pd(_mm256_fnmadd_pd(x1, x1, one)));
+        acc2 = _mm256_add_pd(acc2, _mm256_sqrt_pd(_mm256_fnmadd_pd(x2, x2, one)));
+        acc3 = _mm256_add_pd(acc3, _mm256_sqrt_pd(_mm256_fnmadd_pd(x3, x3, one)));
+        xi0 = _mm256_add_pd(xi0, step);
+        xi1 = _mm256_add_pd(xi1, step);
+        xi2 = _mm256_add_pd(xi2, step);
+        xi3 = _mm256_add_pd(xi3, step);
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    const double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return sum + sum_tail(begin + blocks * 16, end, offset, h);
+}
+
+// AVX2 Monte Carlo kernel: 2 vectors of 4 blocks
+TARGET_AVX2 static inline __m256i outside_avx2(__m256i x, __m256i y) {
+    const __m256i xx = _mm256_mul_epu32(x, x), yy = _mm256_mul_epu32(y, y);
+    const __m256i low = _mm256_and_si256(_mm256_and_si256(xx, yy), _mm256_set1_epi64x(1));
+    const __m256i half =
+        _mm256_add_epi64(_mm256_add_epi64(_mm256_srli_epi64(xx, 1), _mm256_srli_epi64(yy, 1)), low);
+    return _mm256_srli_epi64(half, 63);
+}
+
+TARGET_AVX2 static unsigned long hits_avx2(unsigned long begin, unsigned long end, const uint32_t key[2]) {
+    const unsigned long iters = (end - begin) / 8;
+    uint32_t k0[PHILOX_ROUNDS], k1[PHILOX_ROUNDS];
+    round_keys(key, k0, k1);
+    const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0), m1 = _mm256_set1_epi64x(PHILOX_M1);
+    const __m256i step = _mm256_set1_epi64x(8);
+    __m256i b[2] = {_mm256_add_epi64(_mm256_set1_epi64x(begin), _mm256_setr_epi64x(0, 1, 2, 3)),
+                    _mm256_add_epi64(_mm256_set1_epi64x(begin), _mm256_setr_epi64x(4, 5, 6, 7))};
+    __m256i misses = _mm256_setzero_si256();
+
+    for (unsigned long i = 0; i < iters; i++) {
+        __m256i c0[2], c1[2], c2[2], c3[2];
+        for (int v = 0; v < 2; v++) {
+            c0[v] = b[v];
+            c1[v] = _mm256_srli_epi64(b[v], 32);
+            c2[v] = c3[v] = _mm256_setzero_si256();
+        }
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+            const __m256i rk0 = _mm256_set1_epi64x(k0[r]), rk1 = _mm256_set1_epi64x(k1[r]);
+            for (int v = 0; v < 2; v++) {
+                const __m256i p0 = _mm256_mul_epu32(m0, c0[v]), p1 = _mm256_mul_epu32(m1, c2[v]);
+                c0[v] = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1[v]), rk0);
+                c2[v] = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3[v]), rk1);
+                c1[v] = p1;
+                c3[v] = p0;
+            }
+        }
+        for (int v = 0; v < 2; v++) {
+            misses = _mm256_add_epi64(misses, outside_avx2(c0[v], c1[v]));
+            misses = _mm256_add_epi64(misses, outside_avx2(c2[v], c3[v]));
+            b[v] = _mm256_add_epi64(b[v], step);
+        }
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, misses);
+    const uint64_t missed = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return 16 * iters - missed + hits_generic(begin + iters * 8, end, key);
+}
+
+// AVX-512 kernel: 4 accumulators of 8 doubles
+TARGET_AVX512 static double sum_avx512(unsigned long begin, unsigned long end, double offset,
+                                       double h) {
+    const unsigned long blocks = (end - begin) / 32;
+    const __m512d vh = _mm512_set1_pd(h), one = _mm512_set1_pd(1.0), step = _mm512_set1_pd(32.0);
+    __m512d xi0 = _mm512_add_pd(_mm512_set1_pd(begin + offset),
+                                _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+    __m512d xi1 = _mm512_add_pd(xi0, _mm512_set1_pd(8.0));
+    __m512d xi2 = _mm512_add_pd(xi0, _mm512_set1_pd(16.0));
+    __m512d xi3 = _mm512_add_pd(xi0, _mm512_set1_pd(24.0));
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+
+    for (unsigned long b = 0; b < blocks; b++) {
+        __m512d x0 = _mm512_mul_pd(xi0, vh), x1 = _mm512_mul_pd(xi1, vh);
+        __m512d x2 = _mm512_mul_pd(xi2, vh), x3 = _mm512_mul_pd(xi3, vh);
+        acc0 = _mm512_add_pd(acc0, _mm512_sqrt_pd(_mm512_fnmadd_pd(x0, x0, one)));
+        acc1 = _mm512_add_pd(acc1, _mm512_sqrt_pd(_mm512_fnmadd_pd(x1, x1, one)));
+        acc2 = _mm512_add_pd(acc2, _mm512_sqrt_pd(_mm512_fnmadd_pd(x2, x2, one)));
+        acc3 = _mm512_add_pd(acc3, _mm512_sqrt_pd(_mm512_fnmadd_pd(x3, x3, one)));
+        xi0 = _mm512_add_pd(xi0, step);
+        xi1 = _mm512_add_pd(xi1, step);
+        xi2 = _mm512_add_pd(xi2, step);
+        xi3 = _mm512_add_pd(xi3, step);
+    }
+
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+    const double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+                       ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    return sum + sum_tail(begin + blocks * 32, end, offset, h);
+}
+
+// AVX-512 Monte Carlo kernel: 2 vectors of 8 blocks
+TARGET_AVX512 static inline __m512i outside_avx512(__m512i x, __m512i y) {
+    const __m512i xx = _mm512_mul_epu32(x, x), yy = _mm512_mul_epu32(y, y);
+    const __m512i low = _mm512_and_si512(_mm512_and_si512(xx, yy), _mm512_set1_epi64(1));
+    const __m512i half =
+        _mm512_add_epi64(_mm512_add_epi64(_mm512_srli_epi64(xx, 1), _mm512_srli_epi64(yy, 1)), low);
+    return _mm512_srli_epi64(half, 63);
+}
+
+TARGET_AVX512 static unsigned long hits_avx512(unsigned long begin, unsigned long end,
+                                               const uint32_t key[2]) {
+    const unsigned long iters = (end - begin) / 16;
+    uint32_t k0[PHILOX_ROUNDS], k1[PHILOX_ROUNDS];
+    round_keys(key, k0, k1);
+    const __m512i m0 = _mm512_set1_epi64(PHILOX_M0), m1 = _mm512_set1_epi64(PHILOX_M1);
+    const __m512i step = _mm512_set1_epi64(16);
+    __m512i b[2] = {
+        _mm512_add_epi64(_mm512_set1_epi64(begin), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7)),
+        _mm512_add_epi64(_mm512_set1_epi64(begin), _mm512_setr_epi64(8, 9, 10, 11, 12, 13, 14, 15)),
+    };
+    __m512i misses = _mm512_setzero_si512();
+
+    for (unsigned long i = 0; i < iters; i++) {
+        __m512i c0[2], c1[2], c2[2], c3[2];
+        for (int v = 0; v < 2; v++) {
+            c0[v] = b[v];
+            c1[v] = _mm512_srli_epi64(b[v], 32);
+            c2[v] = c3[v] = _mm512_setzero_si512();
+        }
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+            const __m512i rk0 = _mm512_set1_epi64(k0[r]), rk1 = _mm512_set1_epi64(k1[r]);
+            for (int v = 0; v < 2; v++) {
+                const __m512i p0 = _mm512_mul_epu32(m0, c0[v]), p1 = _mm512_mul_epu32(m1, c2[v]);
+                c0[v] = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1[v]), rk0);
+                c2[v] = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3[v]), rk1);
+                c1[v] = p1;
+                c3[v] = p0;
+            }
+        }
+        for (int v = 0; v < 2; v++) {
+            misses = _mm512_add_epi64(misses, outside_avx512(c0[v], c1[v]));
+            misses = _mm512_add_epi64(misses, outside_avx512(c2[v], c3[v]));
+            b[v] = _mm512_add_epi64(b[v], step);
+        }
+    }
+
+    const uint64_t missed = (uint64_t)_mm512_reduce_add_epi64(misses);
+    return 32 * iters - missed + hits_generic(begin + iters * 16, end, key);
+}
+#endif
+
+// Available kernels, from the most to the least preferred one
+static const struct {
+    unsigned features;
+    pi_kernel kernel;
+} kernels[] = {
+#ifdef PI_X86
+    {CPU_FEATURE_AVX512F, {"avx512", 32, sum_avx512, hits_avx512}},
+    {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, {"avx2", 16, sum_avx2, hits_avx2}},
+    {CPU_FEATURE_SSE2, {"sse2", 8, sum_sse2, hits_sse2}},
+#endif
+    {0, {"generic", 4, sum_generic, hits_generic}},
+};
+static const size_t num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+const pi_kernel *pi_kernel_find(const char *name) {
+    for (size_t i = 0; i < num_kernels; i++) {
+        if (!strcmp(kernels[i].kernel.name, name))
+            return cpu_supports(kernels[i].features) ? &kernels[i].kernel : NULL;
+    }
+    return NULL;
+}
+
+static const pi_kernel *select_kernel(void) {
+    const char *forced = getenv("PI_KERNEL");
+    if (forced) {
+        const pi_kernel *kernel = pi_kernel_find(forced);
+        if (kernel)
+            return kernel;
+        fprintf(stderr, "Warning: kernel '%s' is not available, using the default one\n", forced);
+    }
+
+    for (size_t i = 0; i < num_kernels; i++) {
+        if (cpu_supports(kernels[i].features))
+            return &kernels[i].kernel;
+    }
+    return &kernels[num_kernels - 1].kernel;
+}
+
+const pi_kernel *pi_kernel_get(void) {
+    // The selection is idempotent, so concurrent first calls are harmless
+    static const pi_kernel *selected = NULL;
+    if (!selected)
+        selected = select_kernel();
+    return selected;
+}
+
+double pi_simd(unsigned long N, unsigned long *evals) {
+    *evals = N;
+    if (N == 0)
+        return 0.0;
+    return 4.0 / N * pi_kernel_get()->fn(0, N, 0.5, 1.0 / N);
+}
+
+double pi_parallel(unsigned long N, unsigned long *evals) {
+    *evals = N;
+    if (N == 0)
+        return 0.0;
+
+    unsigned long chunk = (N + PI_MAX_CHUNKS - 1) / PI_MAX_CHUNKS;
+    if (chunk < PI_CHUNK)
+        chunk = PI_CHUNK;
+    const unsigned long chunks = (N + chunk - 1) / chunk;
+    double *partial = (double *)malloc(chunks * sizeof(double));
+    if (!partial)
+        return pi_simd(N, evals);
+
+    const pi_sum_fn fn = pi_kernel_get()->fn;
+    const double h = 1.0 / N;
+#pragma omp parallel for schedule(static)
+    for (unsigned long c = 0; c < chunks; c++) {
+        const unsigned long begin = c * chunk;
+        partial[c] = fn(begin, begin + chunk < N ? begin + chunk : N, 0.5, h);
+    }
+
+    // The shape of the tree only depends on the number of chunks
+    for (unsigned long stride = 1; stride < chunks; stride *= 2) {
+        for (unsigned long c = 0; c + stride < chunks; c += 2 * stride)
+            partial[c] += partial[c + stride];
+    }
+
+    const double sum = partial[0];
+    free(partial);
+    return 4.0 / N * sum;
+}
+
+double pi_montecarlo(unsigned long N, uint64_t seed, unsigned long *evals) {
+    *evals = N;
+    if (N == 0)
+        return 0.0;
+
+    const uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+    const pi_hits_fn hits = pi_kernel_get()->hits;
+    const unsigned long blocks = N / 2;
+    const unsigned long chunks = (blocks + PI_MC_CHUNK - 1) / PI_MC_CHUNK;
+
+    // Counts are integers, so their sum does not depend on the order
+    unsigned long inside = 0;
+#pragma omp parallel for schedule(static) reduction(+ : inside)
+    for (unsigned long c = 0; c < chunks; c++) {
+        const unsigned long begin = c * PI_MC_CHUNK;
+        inside += hits(begin, begin + PI_MC_CHUNK < blocks ? begin + PI_MC_CHUNK : blocks, key);
+    }
+
+    // An odd N uses the first point of one more block
+    if (N % 2) {
+        const uint32_t ctr[4] = {(uint32_t)blocks, (uint32_t)((uint64_t)blocks >> 32), 0, 0};
+        uint32_t words[4];
+        philox4x32(ctr, key, words);
+        inside += 1 - outside(words[0], words[1]);
+    }
+
+    return 4.0 * inside / N;
+}
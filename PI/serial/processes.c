@@ -0,0 +1,219 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <clock.h>
+#include <pi_kernels.h>
+#include <processes.h>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define PI_FORK 1
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#define CACHE_LINE 64
+
+// Largest number of CPUs considered for pinning
+#define MAX_CPUS 1024
+
+// Slot of a worker in the shared page, alone in its cache line
+typedef union slot {
+    pi_worker worker;
+    char pad[CACHE_LINE];
+} slot;
+
+// Socket of a CPU, or -1 if it is unknown
+static int package_of(int cpu) {
+    int package = -1;
+#ifdef __linux__
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE *file = fopen(path, "r");
+    if (file) {
+        if (fscanf(file, "%d", &package) != 1)
+            package = -1;
+        fclose(file);
+    }
+#else
+    (void)cpu;
+#endif
+    return package;
+}
+
+int pi_available_cpus(void) {
+#ifdef __linux__
+    cpu_set_t set;
+    if (!sched_getaffinity(0, sizeof(set), &set))
+        return CPU_COUNT(&set);
+#endif
+#ifdef PI_FORK
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online > 0)
+        return (int)online;
+#endif
+    return 1;
+}
+
+// Fills cpus with the CPUs the process may run on, in the order of the
+// placement, and returns their number (zero if they cannot be known)
+static int list_cpus(int placement, int *cpus, int max) {
+    int count = 0;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set))
+        return 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++)
+        if (CPU_ISSET(cpu, &set))
+            cpus[count++] = cpu;
+#else
+    (void)cpus;
+    (void)max;
+#endif
+    if (placement != PLACE_SOCKETS || count < 2)
+        return count;
+
+    // Sockets: the i-th CPU of every socket comes before the (i + 1)-th one of
+    // any socket (insertion sort by rank within the socket, then by socket)
+    int *package = (int *)malloc(2 * count * sizeof(int));
+    if (!package)
+        return count;
+    int *rank = package + count;
+    for (int i = 0; i < count; i++) {
+        package[i] = package_of(cpus[i]);
+        rank[i] = 0;
+        for (int j = 0; j < i; j++)
+            rank[i] += package[j] == package[i];
+    }
+    for (int i = 1; i < count; i++) {
+        const int cpu = cpus[i], p = package[i], r = rank[i];
+        int j = i;
+        for (; j > 0 && (rank[j - 1] > r || (rank[j - 1] == r && package[j - 1] > p)); j--) {
+            cpus[j] = cpus[j - 1];
+            package[j] = package[j - 1];
+            rank[j] = rank[j - 1];
+        }
+        cpus[j] = cpu;
+        package[j] = p;
+        rank[j] = r;
+    }
+    free(package);
+    return count;
+}
+
+// Computes the range of a worker (in the worker process, when forked)
+static void run_worker(pi_worker *worker, double h) {
+    const double start = getClock();
+    worker->sum = pi_kernel_get()->fn(worker->begin, worker->end, 0.5, h);
+    worker->time = getClock() - start;
+#ifdef __linux__
+    worker->cpu = sched_getcpu();
+#endif
+}
+
+// Pins the calling process to a CPU (if known and supported)
+static void pin(int cpu) {
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+double pi_processes(unsigned long N, int count, int placement, pi_worker *workers,
+                    unsigned long *evals) {
+    *evals = N;
+    if (count < 1)
+        count = 1;
+
+    // The ranges differ at most by one step
+    const double h = 1.0 / N;
+    const unsigned long share = N / count, extra = N % count;
+    int *cpus = (int *)malloc(MAX_CPUS * sizeof(int));
+    const int num_cpus = cpus ? list_cpus(placement, cpus, MAX_CPUS) : 0;
+    if (num_cpus && count > num_cpus)
+        fprintf(stderr, "Warning: %d workers for %d CPU(s), their times include time-slicing\n",
+                count, num_cpus);
+    for (int w = 0; w < count; w++) {
+        const unsigned long rank = (unsigned long)w;
+        workers[w].begin = share * rank + (rank < extra ? rank : extra);
+        workers[w].end = workers[w].begin + share + (rank < extra);
+        workers[w].cpu = num_cpus ? cpus[w % num_cpus] : -1;
+        workers[w].package = -1;
+        workers[w].sum = 0.0;
+        workers[w].time = 0.0;
+    }
+    free(cpus);
+
+    // Without a shared page the ranges are computed here, as is the range of a
+    // worker that cannot be forked
+    int failed = 0, forked = 0;
+#ifdef PI_FORK
+    pid_t *pids = (pid_t *)malloc(count * sizeof(pid_t));
+    slot *slots = (slot *)mmap(NULL, count * sizeof(slot), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (!pids || slots == MAP_FAILED) {
+        free(pids);
+        pids = NULL;
+        if (slots != MAP_FAILED)
+            munmap(slots, count * sizeof(slot));
+        slots = NULL;
+    }
+
+    if (slots) {
+        // The kernel is selected once, and pending output is not duplicated
+        pi_kernel_get();
+        fflush(stdout);
+        for (int w = 0; w < count; w++) {
+            slots[w].worker = workers[w];
+            pids[w] = fork();
+            if (pids[w] == 0) {
+                pin(slots[w].worker.cpu);
+                run_worker(&slots[w].worker, h);
+                _exit(0);
+            }
+            if (pids[w] < 0)
+                run_worker(&slots[w].worker, h);
+        }
+
+        for (int w = 0; w < count; w++) {
+            int status = 0;
+            if (pids[w] > 0 && (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) ||
+                                WEXITSTATUS(status) != 0)) {
+                fprintf(stderr, "Error: worker %d failed\n", w);
+                failed = 1;
+            }
+            workers[w] = slots[w].worker;
+        }
+        munmap(slots, count * sizeof(slot));
+        free(pids);
+        forked = 1;
+    }
+#endif
+    if (!forked) {
+        for (int w = 0; w < count; w++)
+            run_worker(&workers[w], h);
+    }
+
+    // Reduction in worker order
+    double sum = 0.0;
+    for (int w = 0; w < count; w++) {
+        workers[w].package = workers[w].cpu >= 0 ? package_of(workers[w].cpu) : -1;
+        sum += workers[w].sum;
+    }
+    if (failed)
+        return NAN;
+    return N ? 4.0 / N * sum : 0.0;
+}
@@ -0,0 +1,83 @@
+#include <float.h>
+#include <math.h>
+#include <clock.h>
+#include <pi_kernels.h>
+#include <progressive.h>
+#include <quadrature.h>
+
+// Largest midpoint grid, so that the abscissas of the kernels stay exact
+#define PROGRESSIVE_MAX_POINTS (1ul << 50)
+
+// Returns non-zero if a level that takes growth times as long as the previous
+// one (which ended at now after starting at last) still fits in the budget
+static int fits(double start, double last, double now, double growth, double budget) {
+    return now + growth * (now - last) <= start + budget;
+}
+
+double pi_progressive_midpoint(double budget, pi_progress_fn report, void *data,
+                               unsigned long *evals) {
+    const pi_sum_fn fn = pi_kernel_get()->fn;
+    const double start = getClock();
+
+    pi_progress progress = {0, 1, 1, 0.0, 0.0};
+    double sum = fn(0, 1, 0.5, 1.0);
+    double last = start, now = getClock();
+    progress.estimate = 4.0 * sum;
+    progress.time = now - start;
+    if (report)
+        report(&progress, data);
+
+    // Each level costs three times as much as the previous one
+    while (3 * progress.points <= PROGRESSIVE_MAX_POINTS && fits(start, last, now, 3.0, budget)) {
+        // The new points are at 1/6 and 5/6 of the current cells
+        const unsigned long n = progress.points;
+        const double h = 1.0 / n;
+        sum += fn(0, n, 1.0 / 6.0, h) + fn(0, n, 5.0 / 6.0, h);
+
+        progress.level++;
+        progress.points = 3 * n;
+        progress.evals += 2 * n;
+        progress.estimate = 4.0 / progress.points * sum;
+        last = now;
+        now = getClock();
+        progress.time = now - start;
+        if (report)
+            report(&progress, data);
+    }
+
+    *evals = progress.evals;
+    return progress.estimate;
+}
+
+double pi_progressive_romberg(double budget, pi_progress_fn report, void *data,
+                              unsigned long *evals) {
+    const double start = getClock();
+
+    romberg_table table;
+    romberg_init(&table);
+    double last = start, now = getClock();
+    pi_progress progress = {0, 2, table.evals, romberg_pi(&table), now - start};
+    if (report)
+        report(&progress, data);
+
+    // Each level costs twice as much as the previous one
+    double change = INFINITY;
+    while (change > DBL_EPSILON * progress.estimate && fits(start, last, now, 2.0, budget) &&
+           romberg_refine(&table)) {
+        const double estimate = romberg_pi(&table);
+        change = fabs(estimate - progress.estimate);
+
+        progress.level = table.level;
+        progress.points = (1ul << table.level) + 1;
+        progress.evals = table.evals;
+        progress.estimate = estimate;
+        last = now;
+        now = getClock();
+        progress.time = now - start;
+        if (report)
+            report(&progress, data);
+    }
+
+    *evals = progress.evals;
+    return progress.estimate;
+}
@@ -0,0 +1,176 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <quadrature.h>
+
+// Deepest interval split of pi_adaptive(), which is reached before the
+// intervals become too small for double precision
+#define ADAPTIVE_MAX_DEPTH 40
+
+// Quarter circle after the change of variables x = 1 - u^2
+static inline double integrand(double u) {
+    return 2.0 * u * u * sqrt(2.0 - u * u);
+}
+
+double pi_simpson(unsigned long n, unsigned long *evals) {
+    n = n < 2 ? 2 : n + n % 2;
+    const double h = 1.0 / n;
+
+    // Odd points have weight 4 and the interior even ones weight 2
+    double odd = 0.0, even = 0.0;
+    for (unsigned long i = 1; i < n; i += 2)
+        odd += integrand(i * h);
+    for (unsigned long i = 2; i < n; i += 2)
+        even += integrand(i * h);
+
+    *evals = n + 1;
+    return 4.0 * h / 3.0 * (integrand(0.0) + 4.0 * odd + 2.0 * even + integrand(1.0));
+}
+
+// Gauss-Legendre rule on the same integrand, vectorized by integrate.h
+INTEGRATE_DEFINE(quarter_circle, integrand(x))
+
+double pi_gauss(unsigned long n, unsigned long *evals) {
+    if (n == 0)
+        n = 1;
+    *evals = n * INTEGRATE_POINTS;
+    return 4.0 * integrate_quarter_circle(0.0, 1.0, n, NULL);
+}
+
+// Sub-intervals of [0, 1] for the batched methods
+static integrate_task *split_tasks(unsigned long count) {
+    integrate_task *tasks = (integrate_task *)malloc(count * sizeof(integrate_task));
+    for (unsigned long t = 0; tasks && t < count; t++) {
+        tasks[t].a = (double)t / count;
+        tasks[t].b = (double)(t + 1) / count;
+        tasks[t].n = BATCH_PANELS;
+        tasks[t].p = NULL;
+    }
+    return tasks;
+}
+
+double pi_batch(unsigned long count, unsigned long *evals) {
+    *evals = 0;
+    integrate_task *tasks = split_tasks(count);
+    double *results = (double *)malloc(count * sizeof(double));
+    if (!tasks || !results) {
+        free(tasks);
+        free(results);
+        return 0.0;
+    }
+
+    integrate_quarter_circle_batch(count, tasks, results);
+    double sum = 0.0;
+    for (unsigned long t = 0; t < count; t++)
+        sum += results[t];
+
+    free(tasks);
+    free(results);
+    *evals = count * BATCH_PANELS * INTEGRATE_POINTS;
+    return 4.0 * sum;
+}
+
+double pi_batch_calls(unsigned long count, unsigned long *evals) {
+    *evals = 0;
+    integrate_task *tasks = split_tasks(count);
+    if (!tasks)
+        return 0.0;
+
+    double sum = 0.0;
+    for (unsigned long t = 0; t < count; t++)
+        sum += integrate_quarter_circle_parallel(tasks[t].a, tasks[t].b, tasks[t].n, tasks[t].p);
+
+    free(tasks);
+    *evals = count * BATCH_PANELS * INTEGRATE_POINTS;
+    return 4.0 * sum;
+}
+
+void romberg_init(romberg_table *table) {
+    table->level = 0;
+    table->evals = 2;
+    table->row[0] = 0.5 * (integrand(0.0) + integrand(1.0));
+}
+
+int romberg_refine(romberg_table *table) {
+    if (table->level + 1 >= ROMBERG_MAX_LEVELS)
+        return 0;
+
+    // Midpoints of the current intervals, which halve the step
+    const unsigned long intervals = 1ul << table->level;
+    const double h = 0.5 / intervals;
+    double midpoints = 0.0;
+    for (unsigned long i = 0; i < intervals; i++)
+        midpoints += integrand((2 * i + 1) * h);
+    table->evals += intervals;
+    table->level++;
+
+    // The row is updated in place, keeping R(k - 1, j - 1) aside
+    double above = table->row[0];
+    table->row[0] = 0.5 * above + h * midpoints;
+    double factor = 4.0;
+    for (int j = 1; j <= table->level; j++) {
+        // The last entry of the row is new, so it has no previous value
+        const double next = j < table->level ? table->row[j] : 0.0;
+        table->row[j] = table->row[j - 1] + (table->row[j - 1] - above) / (factor - 1.0);
+        above = next;
+        factor *= 4.0;
+    }
+    return 1;
+}
+
+double romberg_pi(const romberg_table *table) {
+    return 4.0 * table->row[table->level];
+}
+
+double pi_romberg(unsigned long n, unsigned long *evals) {
+    romberg_table table;
+    romberg_init(&table);
+    while ((1ul << table.level) < n && romberg_refine(&table))
+        ;
+
+    *evals = table.evals;
+    return romberg_pi(&table);
+}
+
+// Simpson rule on [a, b] from the values at both ends and at the midpoint m
+static inline double simpson(double a, double b, double fa, double fm, double fb) {
+    return (b - a) / 6.0 * (fa + 4.0 * fm + fb);
+}
+
+/*   Adaptive Simpson on [a, b], where whole is the Simpson rule on it
+
+     Halving [a, b] reduces the error of the Simpson rule by about 16, so the
+     difference between both halves and the whole interval estimates the error
+     of the halves (times 15). Intervals are split until that estimate is below
+     their share of the tolerance, and the accepted values are corrected with
+     it (Richardson extrapolation).
+*/
+static double adaptive(double a, double b, double fa, double fm, double fb, double whole,
+                       double tol, int depth, unsigned long *evals) {
+    const double m = 0.5 * (a + b);
+    const double lm = 0.5 * (a + m), rm = 0.5 * (m + b);
+    const double flm = integrand(lm), frm = integrand(rm);
+    *evals += 2;
+
+    const double left = simpson(a, m, fa, flm, fm);
+    const double right = simpson(m, b, fm, frm, fb);
+    const double delta = left + right - whole;
+    if (depth >= ADAPTIVE_MAX_DEPTH || fabs(delta) <= 15.0 * tol)
+        return left + right + delta / 15.0;
+
+    return adaptive(a, m, fa, flm, fm, left, 0.5 * tol, depth + 1, evals) +
+           adaptive(m, b, fm, frm, fb, right, 0.5 * tol, depth + 1, evals);
+}
+
+double pi_adaptive(double tol, unsigned long *evals) {
+    const double fa = integrand(0.0), fm = integrand(0.5), fb = integrand(1.0);
+    *evals = 3;
+
+    // Errors below the rounding of pi itself cannot be told apart
+    if (!(tol > 4.0 * DBL_EPSILON))
+        tol = 4.0 * DBL_EPSILON;
+
+    // The tolerance is for pi, four times the integral
+    return 4.0 * adaptive(0.0, 1.0, fa, fm, fb, simpson(0.0, 1.0, fa, fm, fb), 0.25 * tol, 0,
+                          evals);
+}
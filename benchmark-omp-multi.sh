@@ -119,7 +119,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for --explicit-privatization y atmux.c:22:5 \
+printRunComm "codee rewrite --multi omp-for --explicit-privatization y atmux.c:23:5 \
  --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 sed -i 's/\/\* y start \*\//0/g' "atmux.c"
 sed -i 's/\/\* y length \*\//n/g' "atmux.c"
@@ -164,7 +164,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for canny.c:474:4,492:4 \
+printRunComm "codee rewrite --multi omp-for canny.c:482:4,500:4 \
  --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -205,7 +205,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for coulomb.c:26:2 \
+printRunComm "codee rewrite --multi omp-for coulomb.c:27:2 \
  --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -245,7 +245,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for --config compile_commands.json main.c:132:7 \
+printRunComm "codee rewrite --multi omp-for --config compile_commands.json main.c:138:7 \
   -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -285,7 +285,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for main.c:15:5 \
+printRunComm "codee rewrite --multi omp-for main.c:27:5 \
  --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -325,7 +325,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for CG/cg.c:458:5 \
+printRunComm "codee rewrite --multi omp-for CG/cg.c:468:5 \
   --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -365,7 +365,7 @@ $CALL_GENERATOR -C build
 
 printf "\nStep 2: Optimizing code with multithreading\n"
 
-printRunComm "codee rewrite --multi omp-for pi.c:31:5 \
+printRunComm "codee rewrite --multi omp-for pi.c:20:5 \
  --config build/compile_commands.json -i --brief $CODEE_FLAGS"
 
 printf "\nStep 3: Compiling optimized code\n"
@@ -94,7 +94,7 @@ cd MATMUL/serial
 
 printf "\nStep 1: Geting Codee checkers report\n"
 
-printRunComm "codee checks main.c:matmul --brief $CODEE_FLAGS -- -I include/"
+printRunComm "codee checks main.c:matmul --brief $CODEE_FLAGS -- -I include/ -I ../../common/"
 
 printf "\nStep 2: Compiling serial code\n"
 if command -v ${CC:-cc} &>/dev/null; then
@@ -112,8 +112,8 @@ fi
 
 printf "\nStep 3: Optimizing code using loop interchange\n"
 
-printRunComm "codee rewrite --memory loop-interchange main.c:16:9 \
- -i --brief $CODEE_FLAGS -- -I include/"
+printRunComm "codee rewrite --memory loop-interchange main.c:28:9 \
+ -i --brief $CODEE_FLAGS -- -I include/ -I ../../common/"
 
 printf "\nStep 4: Compiling optimized code\n"
 if command -v ${CC:-cc} &>/dev/null; then
@@ -0,0 +1,83 @@
+#include <cpu_features.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef CPU_X86
+// Queries the selected CPUID leaf and sub-leaf (regs = eax, ebx, ecx, edx)
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+    __cpuidex((int *)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Reads the XCR0 register to know which register states the OS saves
+static unsigned long long xgetbv0(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static unsigned detect_features(void) {
+    unsigned features = 0;
+    unsigned regs[4];
+
+    cpuid(0, 0, regs);
+    const unsigned max_leaf = regs[0];
+
+    cpuid(1, 0, regs);
+    if (regs[3] & (1u << 26))
+        features |= CPU_FEATURE_SSE2;
+
+    // The AVX family can only be used if the OS saves the extended registers
+    const int osxsave = (regs[2] & (1u << 27)) != 0;
+    const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    const int os_avx = (xcr0 & 0x6) == 0x6;
+    const int os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+    if (os_avx && (regs[2] & (1u << 12)))
+        features |= CPU_FEATURE_FMA;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        if (os_avx && (regs[1] & (1u << 5)))
+            features |= CPU_FEATURE_AVX2;
+        if (os_avx512 && (regs[1] & (1u << 16)))
+            features |= CPU_FEATURE_AVX512F;
+        if (os_avx512 && (regs[2] & (1u << 11)))
+            features |= CPU_FEATURE_AVX512VNNI;
+    }
+
+    return features;
+}
+#else
+static unsigned detect_features(void) {
+    return 0;
+}
+#endif
+
+// Marks the cached feature set as valid (the detection itself is idempotent)
+#define CPU_FEATURES_DETECTED (1u << 31)
+
+unsigned cpu_features(void) {
+    static unsigned features = 0;
+    if (!features)
+        features = detect_features() | CPU_FEATURES_DETECTED;
+    return features & ~CPU_FEATURES_DETECTED;
+}
+
+int cpu_supports(unsigned features) {
+    return (cpu_features() & features) == features;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef _CPU_FEATURES_H_
+#define _CPU_FEATURES_H_
+
+// Instruction set extensions that can be detected at runtime
+#define CPU_FEATURE_SSE2 (1u << 0)
+#define CPU_FEATURE_AVX2 (1u << 1)
+#define CPU_FEATURE_FMA (1u << 2)
+#define CPU_FEATURE_AVX512F (1u << 3)
+#define CPU_FEATURE_AVX512VNNI (1u << 4)
+
+// Returns the set of CPU_FEATURE_* flags supported by both the CPU and the OS
+unsigned cpu_features(void);
+
+// Returns non-zero if all the selected CPU_FEATURE_* flags are supported
+int cpu_supports(unsigned features);
+
+// Each SIMD kernel is compiled for its own instruction set so that a single
+// binary runs on every host; dispatchers only call the supported ones
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#define TARGET_AVX512VNNI __attribute__((target("avx512f,avx512vnni")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define TARGET_AVX512VNNI
+#endif
+
+// Code written without intrinsics can instead be compiled once per instruction
+// set and dispatched by the loader (GCC and Clang on x86 Linux)
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__linux__)
+#define TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define TARGET_CLONES
+#endif
+
+#endif
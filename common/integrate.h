@@ -0,0 +1,121 @@
+#pragma once
+#ifndef _INTEGRATE_H_
+#define _INTEGRATE_H_
+
+#include <stddef.h>
+#include <cpu_features.h>
+
+/*   Vectorized 1D integration specialized for each integrand at compile time
+
+     Calling the integrand through a function pointer prevents the compiler
+     from inlining and vectorizing it, so each integrand gets its own instance
+     of the integration routines instead, generated by a macro (the C version
+     of a template):
+
+       // In a header, for the users of the instance
+       INTEGRATE_DECLARE(bell);
+
+       // In one source file: an expression of x and of the parameters p
+       INTEGRATE_DEFINE(bell, 1.0 / (1.0 + p[0] * x * x));
+
+     which defines, for the integral of the expression over [a, b] with a
+     Gauss-Legendre rule of INTEGRATE_POINTS points on each of n panels:
+
+       double integrate_bell(double a, double b, unsigned long n, const double *p);
+       double integrate_bell_parallel(double a, double b, unsigned long n, const double *p);
+       void integrate_bell_batch(size_t count, const integrate_task *tasks, double *results);
+
+     The first one is vectorized across panels and compiled for each
+     instruction set (see TARGET_CLONES). The parallel one splits a single
+     large integral among the OpenMP threads. The batched one computes many
+     small integrals, each with its own bounds and parameters, in a single
+     parallel region, so the cost of starting the threads is paid once for
+     all of them.
+
+     The loops are only vectorized when the math functions called by the
+     expression need not set errno (-fno-math-errno).
+*/
+
+#define INTEGRATE_POINTS 5
+
+// Panels per vectorized block (the index of the inner loop is an int, whose
+// conversion to double vectorizes)
+#define INTEGRATE_BLOCK 1024
+
+// Panels per chunk of the parallel version, and integrals per chunk of the
+// batched one
+#define INTEGRATE_CHUNK (1ul << 16)
+#define INTEGRATE_BATCH_GRAIN 16
+
+// Nodes and weights of the Gauss-Legendre rule on [-1, 1]; the nodes are
+// symmetric, so only the center and the positive ones are given
+#define INTEGRATE_NODE1 0.538469310105683091036314420700208805
+#define INTEGRATE_NODE2 0.906179845938663992797626878299392965
+#define INTEGRATE_WEIGHT0 0.568888888888888888888888888888888889
+#define INTEGRATE_WEIGHT1 0.478628670499366468041291514835638192
+#define INTEGRATE_WEIGHT2 0.236926885056189087514264040719917363
+
+// Integral of a batch: [a, b] with n panels and the parameters p
+typedef struct integrate_task {
+    double a, b;
+    unsigned long n;
+    const double *p;
+} integrate_task;
+
+#define INTEGRATE_DECLARE(name)                                                                    \
+    double integrate_##name(double a, double b, unsigned long n, const double *p);                \
+    double integrate_##name##_parallel(double a, double b, unsigned long n, const double *p);     \
+    void integrate_##name##_batch(size_t count, const integrate_task *tasks, double *results)
+
+#define INTEGRATE_DEFINE(name, expr)                                                               \
+    INTEGRATE_DECLARE(name);                                                                       \
+                                                                                                   \
+    static inline double integrand_##name(double x, const double *p) {                            \
+        (void)p;                                                                                   \
+        return (expr);                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    TARGET_CLONES double integrate_##name(double a, double b, unsigned long n, const double *p) { \
+        if (n == 0)                                                                                \
+            return 0.0;                                                                            \
+        const double h = (b - a) / n;                                                              \
+        const double d1 = 0.5 * h * INTEGRATE_NODE1, d2 = 0.5 * h * INTEGRATE_NODE2;               \
+        double sum = 0.0;                                                                          \
+        for (unsigned long i0 = 0; i0 < n; i0 += INTEGRATE_BLOCK) {                                \
+            const int len = n - i0 < INTEGRATE_BLOCK ? (int)(n - i0) : INTEGRATE_BLOCK;            \
+            const double c0 = a + (i0 + 0.5) * h;                                                  \
+            double block = 0.0;                                                                    \
+            _Pragma("omp simd reduction(+ : block)")                                               \
+            for (int j = 0; j < len; j++) {                                                        \
+                const double c = c0 + j * h;                                                       \
+                block += INTEGRATE_WEIGHT0 * integrand_##name(c, p) +                              \
+                         INTEGRATE_WEIGHT1 *                                                       \
+                             (integrand_##name(c - d1, p) + integrand_##name(c + d1, p)) +         \
+                         INTEGRATE_WEIGHT2 *                                                       \
+                             (integrand_##name(c - d2, p) + integrand_##name(c + d2, p));          \
+            }                                                                                      \
+            sum += block;                                                                          \
+        }                                                                                          \
+        return 0.5 * h * sum;                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    double integrate_##name##_parallel(double a, double b, unsigned long n, const double *p) {    \
+        const unsigned long chunks = (n + INTEGRATE_CHUNK - 1) / INTEGRATE_CHUNK;                  \
+        const double h = (b - a) / n;                                                              \
+        double sum = 0.0;                                                                          \
+        _Pragma("omp parallel for reduction(+ : sum) schedule(static)")                            \
+        for (unsigned long c = 0; c < chunks; c++) {                                               \
+            const unsigned long first = c * INTEGRATE_CHUNK;                                       \
+            const unsigned long last = first + INTEGRATE_CHUNK < n ? first + INTEGRATE_CHUNK : n;  \
+            sum += integrate_##name(a + first * h, a + last * h, last - first, p);                 \
+        }                                                                                          \
+        return sum;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void integrate_##name##_batch(size_t count, const integrate_task *tasks, double *results) {   \
+        _Pragma("omp parallel for schedule(dynamic, INTEGRATE_BATCH_GRAIN)")                       \
+        for (size_t t = 0; t < count; t++)                                                         \
+            results[t] = integrate_##name(tasks[t].a, tasks[t].b, tasks[t].n, tasks[t].p);         \
+    }
+
+#endif
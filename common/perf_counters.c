@@ -0,0 +1,164 @@
+// syscall() and clock_gettime() are not declared in strict ISO C modes
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <perf_counters.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_HAS_EVENTS 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define PERF_X86 1
+#endif
+
+// Bytes moved from memory by each LLC miss
+#define CACHE_LINE 64
+
+static double wall_time(void) {
+#if defined(__linux__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+#ifdef PERF_HAS_EVENTS
+// FP_ARITH_INST_RETIRED with all its scalar and packed umasks; the event is
+// model-specific, so it is only used on Intel CPUs
+#define INTEL_FP_ARITH 0xffc7
+
+static int is_intel(void) {
+#ifdef PERF_X86
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e; // "GenuineIntel"
+#else
+    return 0;
+#endif
+}
+
+static int open_counter(unsigned type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+void perf_region_init(perf_region *region) {
+    region->time = 0.0;
+    region->time_start = 0.0;
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        region->fd[c] = -1;
+
+#ifdef PERF_HAS_EVENTS
+    region->fd[PERF_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    region->fd[PERF_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    region->fd[PERF_L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE,
+                                               PERF_COUNT_HW_CACHE_L1D |
+                                               PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                               PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    region->fd[PERF_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    region->fd[PERF_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    if (is_intel())
+        region->fd[PERF_FP_INSTRUCTIONS] = open_counter(PERF_TYPE_RAW, INTEL_FP_ARITH);
+#endif
+}
+
+void perf_region_begin(perf_region *region) {
+#ifdef PERF_HAS_EVENTS
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        if (region->fd[c] >= 0)
+            ioctl(region->fd[c], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    region->time_start = wall_time();
+}
+
+void perf_region_end(perf_region *region) {
+    region->time += wall_time() - region->time_start;
+#ifdef PERF_HAS_EVENTS
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        if (region->fd[c] >= 0)
+            ioctl(region->fd[c], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+void perf_region_free(perf_region *region) {
+#ifdef PERF_HAS_EVENTS
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+        if (region->fd[c] >= 0)
+            close(region->fd[c]);
+        region->fd[c] = -1;
+    }
+#endif
+}
+
+double perf_region_count(const perf_region *region, int counter) {
+#ifdef PERF_HAS_EVENTS
+    // value, time enabled, time running
+    unsigned long long data[3];
+    if (region->fd[counter] < 0 || read(region->fd[counter], data, sizeof(data)) != sizeof(data))
+        return -1.0;
+    if (data[2] == 0)
+        return data[1] == 0 ? 0.0 : -1.0;
+    return (double)data[0] * ((double)data[1] / data[2]);
+#else
+    (void)region, (void)counter;
+    return -1.0;
+#endif
+}
+
+static void print_count(const char *label, double value) {
+    if (value < 0.0)
+        printf("%s= n/a\n", label);
+    else
+        printf("%s= %.4e\n", label, value);
+}
+
+void perf_region_report(const perf_region *region, double flops) {
+    double counts[PERF_NUM_COUNTERS];
+    int available = 0;
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+        counts[c] = perf_region_count(region, c);
+        available += counts[c] >= 0.0;
+    }
+
+    printf("- Performance counters\n");
+    if (!available) {
+        printf("counters= unavailable\n");
+    } else {
+        print_count("cycles\t", counts[PERF_CYCLES]);
+        print_count("instr\t", counts[PERF_INSTRUCTIONS]);
+        print_count("l1d miss", counts[PERF_L1D_MISSES]);
+        print_count("llc miss", counts[PERF_LLC_MISSES]);
+        print_count("br miss\t", counts[PERF_BRANCH_MISSES]);
+        print_count("fp instr", counts[PERF_FP_INSTRUCTIONS]);
+        if (counts[PERF_CYCLES] > 0.0 && counts[PERF_INSTRUCTIONS] >= 0.0)
+            printf("ipc\t= %.2f\n", counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+    }
+
+    if (flops > 0.0 && region->time > 0.0)
+        printf("gflop/s\t= %.3f\n", flops / region->time * 1e-9);
+    if (flops > 0.0 && counts[PERF_LLC_MISSES] >= 0.0)
+        printf("bytes/flop= %.4f\n", counts[PERF_LLC_MISSES] * CACHE_LINE / flops);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+/*   Hardware performance counters around the timed region of each demo
+
+     Counters are read through Linux perf_event_open, only for the user-space
+     code of this process and of the threads and processes it creates after
+     perf_region_init: threads that already exist (e.g. an OpenMP team started
+     by an earlier parallel region) are not counted, so the region is opened
+     at the start of main. A region can be entered several times and its
+     counts accumulate:
+
+       perf_region region;
+       perf_region_init(&region);
+       perf_region_begin(&region);
+       ... timed code ...
+       perf_region_end(&region);
+       perf_region_report(&region, flops);
+       perf_region_free(&region);
+
+     Counters that cannot be opened (other operating systems, restricted
+     perf_event_paranoid settings, missing hardware events) are reported as
+     n/a, and the report degrades to the wall time only.
+*/
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_FP_INSTRUCTIONS, // Only on Intel (FP_ARITH_INST_RETIRED)
+    PERF_NUM_COUNTERS
+};
+
+typedef struct perf_region {
+    int fd[PERF_NUM_COUNTERS]; // Negative if the counter is not available
+    double time;               // Accumulated wall time, in seconds
+    double time_start;
+} perf_region;
+
+void perf_region_init(perf_region *region);
+void perf_region_begin(perf_region *region);
+void perf_region_end(perf_region *region);
+void perf_region_free(perf_region *region);
+
+// Returns the accumulated count of a counter, scaled when the kernel had to
+// multiplex it, or a negative value if it is not available
+double perf_region_count(const perf_region *region, int counter);
+
+// Prints the counters and the derived IPC, GFLOP/s and bytes/flop (memory
+// traffic estimated from the LLC misses); flops is the number of floating
+// point operations of the region, or zero if it is not known
+void perf_region_report(const perf_region *region, double flops);
+
+#endif
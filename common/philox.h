@@ -0,0 +1,45 @@
+#pragma once
+#ifndef _PHILOX_H_
+#define _PHILOX_H_
+
+#include <stdint.h>
+
+/*   Philox4x32-10 counter-based random number generator
+
+     Each 128-bit counter is mapped to four independent 32-bit random words by
+     ten rounds of multiplications and XORs keyed by a 64-bit seed (Salmon et
+     al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011). There is no
+     state to share or to advance: the i-th number of a stream is computed from
+     i directly, so any thread or SIMD lane can generate any part of the
+     sequence, and the result does not depend on how the work is split.
+*/
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+// out = Philox4x32-10(ctr, key); out may alias ctr
+static inline void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        const uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        const uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+#endif
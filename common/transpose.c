@@ -0,0 +1,262 @@
+#include <stdint.h>
+#include <string.h>
+#include <cpu_features.h>
+#include <transpose.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TRANSPOSE_X86 1
+#include <immintrin.h>
+#endif
+
+// Side of the largest blocks transposed without further splitting: a source
+// and a destination block (or the two blocks swapped in place) fit in L1
+#define TRANSPOSE_LEAF 32
+
+// Destinations of at least this size are written with non-temporal stores.
+// Their lines are fully overwritten, so reading them first (as a regular store
+// miss does) only wastes bandwidth once the source and the destination no
+// longer fit together in L2
+#define TRANSPOSE_STREAM_BYTES ((size_t)1 << 20)
+
+#define ROUND_UP(x, m) (((x) + (m) - 1) / (m) * (m))
+
+// Transposes a tile of A into B; if stream is non-zero, B must be aligned to
+// the vector size and is written with non-temporal stores
+typedef void (*tile_fn)(const double *a, size_t lda, double *b, size_t ldb, int stream);
+
+// Portable 4 x 4 tile (stream is ignored)
+static void tile_generic(const double *restrict a, size_t lda, double *restrict b, size_t ldb,
+                         int stream) {
+    (void)stream;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            b[j * ldb + i] = a[i * lda + j];
+}
+
+#ifdef TRANSPOSE_X86
+TARGET_SSE2 static inline void store_sse2(double *b, __m128d v, int stream) {
+    if (stream)
+        _mm_stream_pd(b, v);
+    else
+        _mm_storeu_pd(b, v);
+}
+
+TARGET_AVX2 static inline void store_avx2(double *b, __m256d v, int stream) {
+    if (stream)
+        _mm256_stream_pd(b, v);
+    else
+        _mm256_storeu_pd(b, v);
+}
+
+TARGET_AVX512 static inline void store_avx512(double *b, __m512d v, int stream) {
+    if (stream)
+        _mm512_stream_pd(b, v);
+    else
+        _mm512_storeu_pd(b, v);
+}
+
+// SSE2 4 x 4 tile, as four 2 x 2 ones
+TARGET_SSE2 static void tile_sse2(const double *restrict a, size_t lda,
+                                  double *restrict b, size_t ldb, int stream) {
+    for (int i = 0; i < 4; i += 2) {
+        for (int j = 0; j < 4; j += 2) {
+            const __m128d r0 = _mm_loadu_pd(&a[i * lda + j]);
+            const __m128d r1 = _mm_loadu_pd(&a[(i + 1) * lda + j]);
+            store_sse2(&b[j * ldb + i], _mm_unpacklo_pd(r0, r1), stream);
+            store_sse2(&b[(j + 1) * ldb + i], _mm_unpackhi_pd(r0, r1), stream);
+        }
+    }
+}
+
+// AVX2 4 x 4 tile: pairs of rows are interleaved within each 128-bit lane, and
+// the lanes are then exchanged
+TARGET_AVX2 static void tile_avx2(const double *restrict a, size_t lda,
+                                  double *restrict b, size_t ldb, int stream) {
+    const __m256d r0 = _mm256_loadu_pd(&a[0 * lda]);
+    const __m256d r1 = _mm256_loadu_pd(&a[1 * lda]);
+    const __m256d r2 = _mm256_loadu_pd(&a[2 * lda]);
+    const __m256d r3 = _mm256_loadu_pd(&a[3 * lda]);
+
+    // { r0[0], r1[0], r0[2], r1[2] }, { r0[1], r1[1], r0[3], r1[3] }, ...
+    const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    store_avx2(&b[0 * ldb], _mm256_permute2f128_pd(t0, t2, 0x20), stream);
+    store_avx2(&b[1 * ldb], _mm256_permute2f128_pd(t1, t3, 0x20), stream);
+    store_avx2(&b[2 * ldb], _mm256_permute2f128_pd(t0, t2, 0x31), stream);
+    store_avx2(&b[3 * ldb], _mm256_permute2f128_pd(t1, t3, 0x31), stream);
+}
+
+// AVX-512 8 x 8 tile: pairs of rows are interleaved within each 128-bit lane,
+// and the lanes are then gathered in two rounds of shuffles (0x88 takes the
+// even lanes of both operands and 0xdd the odd ones)
+TARGET_AVX512 static void tile_avx512(const double *restrict a, size_t lda,
+                                      double *restrict b, size_t ldb, int stream) {
+    __m512d r[8], t[8], u[8];
+    for (int i = 0; i < 8; i++)
+        r[i] = _mm512_loadu_pd(&a[i * lda]);
+
+    // t[2i] = { r[2i][0], r[2i+1][0], r[2i][2], r[2i+1][2], ... }, t[2i+1] the odd columns
+    for (int i = 0; i < 8; i += 2) {
+        t[i] = _mm512_unpacklo_pd(r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_pd(r[i], r[i + 1]);
+    }
+
+    // Rows 0-3 and 4-7 of columns { 0, 4 }, { 2, 6 }, { 1, 5 } and { 3, 7 }
+    for (int h = 0; h < 8; h += 4) {
+        u[h + 0] = _mm512_shuffle_f64x2(t[h + 0], t[h + 2], 0x88);
+        u[h + 1] = _mm512_shuffle_f64x2(t[h + 0], t[h + 2], 0xdd);
+        u[h + 2] = _mm512_shuffle_f64x2(t[h + 1], t[h + 3], 0x88);
+        u[h + 3] = _mm512_shuffle_f64x2(t[h + 1], t[h + 3], 0xdd);
+    }
+
+    store_avx512(&b[0 * ldb], _mm512_shuffle_f64x2(u[0], u[4], 0x88), stream);
+    store_avx512(&b[4 * ldb], _mm512_shuffle_f64x2(u[0], u[4], 0xdd), stream);
+    store_avx512(&b[2 * ldb], _mm512_shuffle_f64x2(u[1], u[5], 0x88), stream);
+    store_avx512(&b[6 * ldb], _mm512_shuffle_f64x2(u[1], u[5], 0xdd), stream);
+    store_avx512(&b[1 * ldb], _mm512_shuffle_f64x2(u[2], u[6], 0x88), stream);
+    store_avx512(&b[5 * ldb], _mm512_shuffle_f64x2(u[2], u[6], 0xdd), stream);
+    store_avx512(&b[3 * ldb], _mm512_shuffle_f64x2(u[3], u[7], 0x88), stream);
+    store_avx512(&b[7 * ldb], _mm512_shuffle_f64x2(u[3], u[7], 0xdd), stream);
+}
+#endif
+
+typedef struct tile_kernel {
+    const char *name;
+    size_t size;  // Side of the tile
+    size_t align; // Alignment of B needed by the non-temporal stores (0: none)
+    tile_fn fn;
+} tile_kernel;
+
+// Available kernels, from the most to the least preferred one
+static const struct {
+    unsigned features;
+    tile_kernel kernel;
+} kernels[] = {
+#ifdef TRANSPOSE_X86
+    {CPU_FEATURE_AVX512F, {"avx512", 8, 64, tile_avx512}},
+    {CPU_FEATURE_AVX2, {"avx2", 4, 32, tile_avx2}},
+    {CPU_FEATURE_SSE2, {"sse2", 4, 16, tile_sse2}},
+#endif
+    {0, {"generic", 4, 0, tile_generic}},
+};
+static const size_t num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+static const tile_kernel *get_kernel(void) {
+    // The selection is idempotent, so concurrent first calls are harmless
+    static const tile_kernel *selected = NULL;
+    if (!selected) {
+        size_t i = 0;
+        while (i < num_kernels - 1 && !cpu_supports(kernels[i].features))
+            i++;
+        selected = &kernels[i].kernel;
+    }
+    return selected;
+}
+
+const char *transpose_kernel(void) {
+    return get_kernel()->name;
+}
+
+// Transposes a block that fits in L1: whole tiles with the kernel, and the
+// remaining right and bottom edges element by element
+static void transpose_leaf(const tile_kernel *kern, size_t rows, size_t cols,
+                           const double *A, size_t lda, double *B, size_t ldb, int stream) {
+    const size_t s = kern->size;
+    const size_t tile_rows = rows / s * s, tile_cols = cols / s * s;
+    for (size_t i = 0; i < tile_rows; i += s)
+        for (size_t j = 0; j < tile_cols; j += s)
+            kern->fn(&A[i * lda + j], lda, &B[j * ldb + i], ldb, stream);
+
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = i < tile_rows ? tile_cols : 0; j < cols; j++)
+            B[j * ldb + i] = A[i * lda + j];
+}
+
+// Halves a dimension on a multiple of the tile size, so that only the blocks
+// on the edges of the matrix have partial tiles
+static size_t split(const tile_kernel *kern, size_t dim) {
+    return ROUND_UP(dim / 2, kern->size);
+}
+
+static void transpose_recursive(const tile_kernel *kern, size_t rows, size_t cols,
+                                const double *A, size_t lda, double *B, size_t ldb,
+                                int stream) {
+    if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF) {
+        transpose_leaf(kern, rows, cols, A, lda, B, ldb, stream);
+    } else if (rows >= cols) {
+        const size_t h = split(kern, rows);
+        transpose_recursive(kern, h, cols, A, lda, B, ldb, stream);
+        transpose_recursive(kern, rows - h, cols, &A[h * lda], lda, &B[h], ldb, stream);
+    } else {
+        const size_t h = split(kern, cols);
+        transpose_recursive(kern, rows, h, A, lda, B, ldb, stream);
+        transpose_recursive(kern, rows, cols - h, &A[h], lda, &B[h * ldb], ldb, stream);
+    }
+}
+
+void transpose(size_t rows, size_t cols, const double *A, size_t lda, double *B, size_t ldb) {
+    const tile_kernel *kern = get_kernel();
+
+    // The tiles begin on multiples of the tile size (see split()), so their rows
+    // in B are aligned if the first one and the leading dimension are
+    const int stream = kern->align && rows * cols * sizeof(double) >= TRANSPOSE_STREAM_BYTES &&
+                       (uintptr_t)B % kern->align == 0 && ldb * sizeof(double) % kern->align == 0;
+    transpose_recursive(kern, rows, cols, A, lda, B, ldb, stream);
+#ifdef TRANSPOSE_X86
+    // Orders the non-temporal stores before any later access to B
+    if (stream)
+        _mm_sfence();
+#endif
+}
+
+/*   In-place transposition of a square matrix
+
+       | A11 A12 |    | A11^T A21^T |
+       | A21 A22 | => | A12^T A22^T |
+
+     The diagonal blocks are transposed in place recursively, and the
+     off-diagonal ones are transposed and swapped with each other. Blocks that
+     fit in L1 go through a scratch block (buf, with rows of TRANSPOSE_LEAF).
+*/
+
+// X (rows x cols), Y (cols x rows) = Y^T, X^T
+static void swap_recursive(const tile_kernel *kern, size_t rows, size_t cols,
+                           double *X, double *Y, size_t ld, double *buf) {
+    if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF) {
+        transpose_leaf(kern, rows, cols, X, ld, buf, TRANSPOSE_LEAF, 0);
+        transpose_leaf(kern, cols, rows, Y, ld, X, ld, 0);
+        for (size_t j = 0; j < cols; j++)
+            memcpy(&Y[j * ld], &buf[j * TRANSPOSE_LEAF], rows * sizeof(double));
+    } else if (rows >= cols) {
+        const size_t h = split(kern, rows);
+        swap_recursive(kern, h, cols, X, Y, ld, buf);
+        swap_recursive(kern, rows - h, cols, &X[h * ld], &Y[h], ld, buf);
+    } else {
+        const size_t h = split(kern, cols);
+        swap_recursive(kern, rows, h, X, Y, ld, buf);
+        swap_recursive(kern, rows, cols - h, &X[h], &Y[h * ld], ld, buf);
+    }
+}
+
+static void square_recursive(const tile_kernel *kern, size_t n, double *A, size_t ld,
+                             double *buf) {
+    if (n <= TRANSPOSE_LEAF) {
+        transpose_leaf(kern, n, n, A, ld, buf, TRANSPOSE_LEAF, 0);
+        for (size_t i = 0; i < n; i++)
+            memcpy(&A[i * ld], &buf[i * TRANSPOSE_LEAF], n * sizeof(double));
+        return;
+    }
+
+    const size_t h = split(kern, n);
+    square_recursive(kern, h, A, ld, buf);
+    square_recursive(kern, n - h, &A[h * ld + h], ld, buf);
+    swap_recursive(kern, h, n - h, &A[h], &A[h * ld], ld, buf);
+}
+
+void transpose_square(size_t n, double *A, size_t lda) {
+    double buf[TRANSPOSE_LEAF * TRANSPOSE_LEAF];
+    square_recursive(get_kernel(), n, A, lda, buf);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef _TRANSPOSE_H_
+#define _TRANSPOSE_H_
+
+#include <stddef.h>
+
+/*   Matrix transposition at close to the memory bandwidth
+
+     A naive transpose walks one of the matrices with a stride of a whole row,
+     so every element it touches costs a cache line and, for large matrices, a
+     TLB entry. Here the matrices are split recursively along their largest
+     dimension until the blocks fit in the L1 cache, which needs no cache size
+     to tune, and each block is transposed in register tiles of 8 x 8 (AVX-512)
+     or 4 x 4 (AVX2, SSE2 and the portable version), selected at runtime.
+
+     Matrices are row-major with a leading dimension (distance between rows, in
+     doubles), so this works both for new_matrix() (see matrix_ld()) and for
+     Matrix2D (ld = cols).
+*/
+
+// B (cols x rows) = A^T for A (rows x cols); A and B must not overlap
+void transpose(size_t rows, size_t cols, const double *A, size_t lda, double *B, size_t ldb);
+
+// A (n x n) = A^T in place
+void transpose_square(size_t n, double *A, size_t lda);
+
+// Name of the register tile kernel used on the running CPU
+const char *transpose_kernel(void);
+
+#endif